@@ -0,0 +1,25 @@
+#include "chunk_ring.h"
+
+#include "pmsis.h"
+
+
+void chunk_ring_reset(chunk_ring_t *r, uint32_t buffers)
+{
+    r->head = 0;
+    r->tail = 0;
+    r->produced = 0;
+    r->overflows = 0;
+    r->buffers = buffers;
+    r->next_seq = 0;
+    r->high_watermark = 0;
+    r->lost = 0;
+    r->dropped = 0;
+    r->concealed = 0;
+    r->bypassed = 0;
+}
+
+void chunk_ring_print(chunk_ring_t *r)
+{
+    printf("Chunk ring: %d chunks, occupancy high-watermark %d/%d, lost %d, dropped %d, concealed %d, bypassed %d\n",
+        r->produced, r->high_watermark, r->buffers, r->lost, r->dropped, r->concealed, r->bypassed);
+}
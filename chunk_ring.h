@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+
+
+/*
+ * Single-producer/single-consumer ring of audio chunk descriptors
+ *
+ * The producer (uDMA end of chunk callback) publishes the sequence number of
+ * every completed chunk, the consumer (processing loop) takes them in order.
+ * The head is only written by the producer and the tail only by the consumer,
+ * so no lock is needed between the callback and the loop. The chunk data stays
+ * in the uDMA buffers: the chunk with sequence number seq is in the buffer
+ * seq % buffers, which is overwritten once the uDMA starts filling the chunk
+ * seq + buffers.
+ */
+// power of two, larger than the number of uDMA buffers
+#ifndef CHUNK_RING_SIZE
+#define CHUNK_RING_SIZE     (16)
+#endif
+
+typedef struct {
+    uint32_t seq[CHUNK_RING_SIZE];
+    volatile uint32_t head;     // descriptors published, producer only
+    volatile uint32_t tail;     // descriptors consumed, consumer only
+    volatile uint32_t produced; // chunks completed by the uDMA, producer only
+    volatile uint32_t overflows;// descriptors not published because the ring was full, producer only
+    uint32_t buffers;           // uDMA buffers
+    uint32_t next_seq;          // sequence number expected by the consumer
+    uint32_t high_watermark;    // max occupancy seen by the consumer
+    uint32_t lost;              // chunks overwritten before being read
+    uint32_t dropped;           // hops skipped by the overrun policy
+    uint32_t concealed;         // hops processed with the previous mask
+    uint32_t bypassed;          // hops processed without mask
+} chunk_ring_t;
+
+/*
+ * \brief clear the ring, buffers is the number of uDMA buffers
+ */
+void chunk_ring_reset(chunk_ring_t *r, uint32_t buffers);
+
+/*
+ * \brief publish the next completed chunk, returns its sequence number (producer)
+ */
+static inline uint32_t chunk_ring_push(chunk_ring_t *r)
+{
+    uint32_t seq = r->produced;
+    r->produced = seq + 1;
+    uint32_t head = r->head;
+    if (head - r->tail == CHUNK_RING_SIZE) {
+        // the consumer finds the gap in the sequence numbers
+        r->overflows++;
+        return seq;
+    }
+    r->seq[head & (CHUNK_RING_SIZE - 1)] = seq;
+    // the descriptor must be written before it is published
+    __asm__ __volatile__ ("" : : : "memory");
+    r->head = head + 1;
+    return seq;
+}
+
+static inline int chunk_ring_empty(chunk_ring_t *r)
+{
+    return r->head == r->tail;
+}
+
+/*
+ * \brief take the oldest descriptor (consumer, the ring must not be empty)
+ *
+ * Returns the number of chunks missing before this one, i.e. the descriptors
+ * that did not fit the ring. *backlog is set to the descriptors still waiting.
+ */
+static inline uint32_t chunk_ring_pop(chunk_ring_t *r, uint32_t *seq, uint32_t *backlog)
+{
+    uint32_t tail = r->tail;
+    uint32_t occupancy = r->head - tail;
+    if (occupancy > r->high_watermark) r->high_watermark = occupancy;
+
+    *seq = r->seq[tail & (CHUNK_RING_SIZE - 1)];
+    __asm__ __volatile__ ("" : : : "memory");
+    r->tail = tail + 1;
+    *backlog = occupancy - 1;
+
+    uint32_t gap = *seq - r->next_seq;
+    r->next_seq = *seq + 1;
+    r->lost += gap;
+    return gap;
+}
+
+/*
+ * \brief check if the buffer of the chunk seq has been overwritten by the uDMA (consumer)
+ */
+static inline int chunk_ring_stale(chunk_ring_t *r, uint32_t seq)
+{
+    // the uDMA is filling the chunk produced, the buffer of seq is reused by seq + buffers
+    if (r->produced - seq >= r->buffers) {
+        r->lost++;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * \brief discard the chunks published so far (consumer)
+ */
+static inline void chunk_ring_skip(chunk_ring_t *r)
+{
+    // produced is read first: a chunk published in between is counted as lost, not repeated
+    uint32_t produced = r->produced;
+    __asm__ __volatile__ ("" : : : "memory");
+    r->tail = r->head;
+    r->next_seq = produced;
+}
+
+/*
+ * \brief print the occupancy high-watermark and the overrun counters
+ */
+void chunk_ring_print(chunk_ring_t *r);
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include "control.h"
+
+
+#define CONTROL_LINE_MAX    (32)
+
+#define BARRIER()   __asm__ __volatile__ ("" : : : "memory")
+
+// written by the sources only, within params_begin/params_end
+static control_params_t params = { .slider = 0, .bypass = 0, .model = "", .gain = 1.0f };
+static volatile uint32_t params_seq;
+static uint32_t snapshot_seq = 0xFFFFFFFF;
+
+/*
+    The sources are FC callbacks, serialized by the event scheduler: they can
+    interrupt a snapshot of the processing loop, never the opposite. So a
+    source never waits, and the loop retries only if it was interrupted.
+*/
+static inline void params_begin(void)
+{
+    params_seq++;
+    BARRIER();
+}
+
+static inline void params_end(void)
+{
+    BARRIER();
+    params_seq++;
+}
+
+int control_snapshot(control_params_t *p)
+{
+    uint32_t seq;
+    do {
+        seq = params_seq;
+        BARRIER();
+        *p = params;
+        BARRIER();
+    } while ((seq & 1) || seq != params_seq);
+
+    int changed = (seq != snapshot_seq);
+    snapshot_seq = seq;
+    return changed;
+}
+
+
+/*
+    ADC slider (ADS1014): the conversion register is selected and read by two
+    asynchronous transfers, the next poll is a timed task
+*/
+#define SLIDER_SELECT   (0)
+#define SLIDER_READ     (1)
+#define SLIDER_DONE     (2)
+
+static struct {
+    pi_device_t *i2c;
+    pi_task_t task;
+    uint32_t period_us;
+    int step;
+} slider;
+static PI_L2 uint8_t slider_buffer[2];
+
+static int ads1014_write(pi_device_t *dev, uint8_t addr, uint16_t value)
+{
+    uint8_t buffer[3] = { addr, value >> 8, value & 0xFF };
+    return pi_i2c_write(dev, buffer, 3, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+}
+
+static uint16_t ads1014_read(pi_device_t *dev, uint8_t addr)
+{
+    uint16_t result;
+    pi_i2c_write(dev, &addr, 1, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+    pi_i2c_read(dev, (uint8_t *)&result, 2, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
+    result = (result << 8) | (result >> 8);
+    return result;
+}
+
+static int init_ads1014(pi_device_t *i2c)
+{
+    struct pi_i2c_conf conf;
+    pi_i2c_conf_init(&conf);
+    conf.itf = 1;
+    pi_i2c_conf_set_slave_addr(&conf, 0x90, 0);
+
+    pi_open_from_conf(i2c, &conf);
+    if (pi_i2c_open(i2c)) return -1;
+
+    uint16_t expected = (1 << 15) | (0 << 12) | (2 << 9) | (7 << 5) | 3;
+    ads1014_write(i2c, 1, expected);
+
+    return 0;
+}
+
+static void slider_step(void *arg)
+{
+    int step = slider.step;
+    slider.step = (step == SLIDER_DONE) ? SLIDER_SELECT : step + 1;
+    pi_task_callback(&slider.task, slider_step, NULL);
+
+    if (step == SLIDER_SELECT) {
+        slider_buffer[0] = 0;
+        pi_i2c_write_async(slider.i2c, slider_buffer, 1, PI_I2C_XFER_START | PI_I2C_XFER_STOP, &slider.task);
+    } else if (step == SLIDER_READ) {
+        pi_i2c_read_async(slider.i2c, slider_buffer, 2, PI_I2C_XFER_START | PI_I2C_XFER_STOP, &slider.task);
+    } else {
+        uint16_t value = (slider_buffer[0] << 8) | slider_buffer[1];
+        if (value != params.slider) {
+            params_begin();
+            params.slider = value;
+            params_end();
+        }
+        pi_task_push_delayed_us(&slider.task, slider.period_us);
+    }
+}
+
+int control_slider_start(pi_device_t *i2c, uint32_t period_us)
+{
+    if (init_ads1014(i2c)) return -1;
+
+    params_begin();
+    params.slider = ads1014_read(i2c, 0);
+    params_end();
+
+    slider.i2c = i2c;
+    slider.period_us = period_us;
+    slider.step = SLIDER_SELECT;
+    pi_task_callback(&slider.task, slider_step, NULL);
+    pi_task_push_delayed_us(&slider.task, period_us);
+    return 0;
+}
+
+
+/*
+    UART commands
+*/
+static struct {
+    pi_device_t dev;
+    pi_task_t task;
+    char line[CONTROL_LINE_MAX];
+    int len;
+} uart;
+static PI_L2 char uart_byte;
+
+static void parse_command(char *line)
+{
+    char *arg = strchr(line, ' ');
+    if (arg == NULL) return;
+    *arg++ = '\0';
+    long value = strtol(arg, NULL, 10);
+
+    params_begin();
+    if (strcmp(line, "bypass") == 0) {
+        params.bypass = (value != 0);
+    } else if (strcmp(line, "gain") == 0) {
+        params.gain = ((value < 0) ? 0 : value) / 100.0f;
+    } else if (strcmp(line, "model") == 0) {
+        if (strcmp(arg, "auto") == 0) arg[0] = '\0';
+        strncpy(params.model, arg, CONTROL_MODEL_NAME - 1);
+        params.model[CONTROL_MODEL_NAME - 1] = '\0';
+    } else if (strcmp(line, "slider") == 0) {
+        params.slider = (uint16_t) value;
+    }
+    params_end();
+}
+
+static void uart_rx(void *arg)
+{
+    char c = uart_byte;
+    if (c == '\n' || c == '\r') {
+        uart.line[uart.len] = '\0';
+        if (uart.len > 0) parse_command(uart.line);
+        uart.len = 0;
+    } else if (uart.len < CONTROL_LINE_MAX - 1) {
+        uart.line[uart.len++] = c;
+    }
+    pi_task_callback(&uart.task, uart_rx, NULL);
+    pi_uart_read_async(&uart.dev, &uart_byte, 1, &uart.task);
+}
+
+int control_uart_start(int itf, uint32_t baudrate)
+{
+    struct pi_uart_conf conf;
+    pi_uart_conf_init(&conf);
+    conf.uart_id = itf;
+    conf.baudrate_bps = baudrate;
+    conf.enable_rx = 1;
+    conf.enable_tx = 1;
+
+    pi_open_from_conf(&uart.dev, &conf);
+    if (pi_uart_open(&uart.dev)) return -1;
+
+    uart.len = 0;
+    pi_task_callback(&uart.task, uart_rx, NULL);
+    pi_uart_read_async(&uart.dev, &uart_byte, 1, &uart.task);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+
+
+/*
+ * Control plane of the runtime parameters (SFU mode)
+ *
+ * The parameter sources run in the FC event callbacks, out of the audio path:
+ * the ADC slider is polled by a chain of asynchronous I2C transfers every
+ * period_us, and the commands of the UART (optional) are read byte by byte by
+ * asynchronous reads. They update a parameter block guarded by a sequence
+ * counter, odd while an update is in progress. The processing loop takes a
+ * snapshot at the start of every hop, so that a hop sees either all or none
+ * of the fields of an update, and never waits for the control I/O.
+ *
+ * UART commands (one per line):
+ *   bypass <0|1>       no filtering of the spectrogram
+ *   gain <percent>     output gain, 100 is unity
+ *   model <name|auto>  model of the MODEL_SET (e.g. denoiser_GRU), auto for the governor
+ *   slider <value>     same as the ADC slider (filtering enabled above CONTROL_SLIDER_THR)
+ */
+#define CONTROL_SLIDER_THR  (28000)
+#define CONTROL_MODEL_NAME  (16)
+
+typedef struct {
+    uint16_t slider;    // last ADC slider value
+    uint8_t bypass;
+    char model[CONTROL_MODEL_NAME];    // model of the MODEL_SET, empty for the governor
+    float gain;         // output gain
+} control_params_t;
+
+/*
+ * \brief set up the ADC slider (blocking, at startup) and start polling it every period_us
+ *
+ * The first value is read before returning. Returns 0 if successful, -1 if the ADC cannot be opened.
+ */
+int control_slider_start(pi_device_t *i2c, uint32_t period_us);
+
+/*
+ * \brief start reading the commands from the UART interface itf
+ *
+ * The interface is dedicated to the commands: not the one of the console.
+ * Returns 0 if successful, -1 if the UART cannot be opened.
+ */
+int control_uart_start(int itf, uint32_t baudrate);
+
+/*
+ * \brief copy the parameters, consistent with the last completed update (processing loop)
+ *
+ * Returns 1 if the parameters changed since the previous snapshot, 0 otherwise.
+ */
+int control_snapshot(control_params_t *p);
@@ -0,0 +1,214 @@
+#include "convert.h"
+
+
+#define CVT_MAX_CORES   (8)
+
+typedef struct {
+    void *dst;
+    const void *src;
+    int n;
+    float scale;
+    float limit;                    // full scale of the integer outputs
+    int clipped[CVT_MAX_CORES];     // per core, summed by the master
+} cvt_arg_t;
+
+
+// range of the n items processed by the current core
+static inline void core_chunk(int n, int *first, int *last)
+{
+    int chunk = (n + pi_cl_team_nb_cores() - 1) / pi_cl_team_nb_cores();
+    *first = pi_core_id() * chunk;
+    *last = (*first + chunk < n) ? (*first + chunk) : n;
+}
+
+static inline int32_t saturate(float v, float limit, int *clipped)
+{
+    if (v >= limit) {
+        (*clipped)++;
+        return (int32_t) limit - 1;
+    }
+    if (v < -limit) {
+        (*clipped)++;
+        return -(int32_t) limit;
+    }
+    return (int32_t) v;
+}
+
+// same, counting the samples beyond the full scale rather than the saturated ones
+static inline int32_t saturate_over(float v, float full_scale, float limit, int *over)
+{
+    if (v >= full_scale || v < -full_scale) (*over)++;
+    if (v >= limit) return (int32_t) limit - 1;
+    if (v < -limit) return -(int32_t) limit;
+    return (int32_t) v;
+}
+
+static int fork_and_sum(void (*fn)(void *), cvt_arg_t *a)
+{
+    int clipped = 0;
+    for (int c = 0; c < CVT_MAX_CORES; c++) a->clipped[c] = 0;
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), fn, a);
+    for (int c = 0; c < CVT_MAX_CORES; c++) clipped += a->clipped[c];
+    return clipped;
+}
+
+
+// the loops are unrolled by 2: the samples are read before being written, so that dst can alias src
+
+static void q15_to_f_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    CVT_TYPE *dst = (CVT_TYPE *) a->dst;
+    const short *src = (const short *) a->src;
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float x0 = (float) src[k] * a->scale;
+        float x1 = (float) src[k+1] * a->scale;
+        dst[k] = (CVT_TYPE) x0;
+        dst[k+1] = (CVT_TYPE) x1;
+    }
+    if (k < last) dst[k] = (CVT_TYPE) ((float) src[k] * a->scale);
+}
+
+static void q31_to_f_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    CVT_TYPE *dst = (CVT_TYPE *) a->dst;
+    const int32_t *src = (const int32_t *) a->src;
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float x0 = (float) src[k] * a->scale;
+        float x1 = (float) src[k+1] * a->scale;
+        dst[k] = (CVT_TYPE) x0;
+        dst[k+1] = (CVT_TYPE) x1;
+    }
+    if (k < last) dst[k] = (CVT_TYPE) ((float) src[k] * a->scale);
+}
+
+static void f32_to_f_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    CVT_TYPE *dst = (CVT_TYPE *) a->dst;
+    const float *src = (const float *) a->src;
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float x0 = src[k];
+        float x1 = src[k+1];
+        dst[k] = (CVT_TYPE) x0;
+        dst[k+1] = (CVT_TYPE) x1;
+    }
+    if (k < last) dst[k] = (CVT_TYPE) src[k];
+}
+
+static void f16_to_f_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    CVT_TYPE *dst = (CVT_TYPE *) a->dst;
+    const float16 *src = (const float16 *) a->src;
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float16 x0 = src[k];
+        float16 x1 = src[k+1];
+        dst[k] = (CVT_TYPE) x0;
+        dst[k+1] = (CVT_TYPE) x1;
+    }
+    if (k < last) dst[k] = (CVT_TYPE) src[k];
+}
+
+static void f_to_q31_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    int32_t *dst = (int32_t *) a->dst;
+    const CVT_TYPE *src = (const CVT_TYPE *) a->src;
+    int *clipped = &a->clipped[pi_core_id()];
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float x0 = (float) src[k] * a->scale;
+        float x1 = (float) src[k+1] * a->scale;
+        dst[k] = saturate_over(x0, a->scale, a->limit, clipped);
+        dst[k+1] = saturate_over(x1, a->scale, a->limit, clipped);
+    }
+    if (k < last) dst[k] = saturate_over((float) src[k] * a->scale, a->scale, a->limit, clipped);
+}
+
+static void f_acc_q15_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    short *dst = (short *) a->dst;
+    const CVT_TYPE *src = (const CVT_TYPE *) a->src;
+    int *clipped = &a->clipped[pi_core_id()];
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        float x0 = (float) dst[k] + (float) src[k] * a->scale;
+        float x1 = (float) dst[k+1] + (float) src[k+1] * a->scale;
+        dst[k] = (short) saturate(x0, a->limit, clipped);
+        dst[k+1] = (short) saturate(x1, a->limit, clipped);
+    }
+    if (k < last) dst[k] = (short) saturate((float) dst[k] + (float) src[k] * a->scale, a->limit, clipped);
+}
+
+static void f_acc_f_core(void *arg)
+{
+    cvt_arg_t *a = (cvt_arg_t *) arg;
+    CVT_TYPE *dst = (CVT_TYPE *) a->dst;
+    const CVT_TYPE *src = (const CVT_TYPE *) a->src;
+    CVT_TYPE gain = (CVT_TYPE) a->scale;
+    int first, last, k;
+    core_chunk(a->n, &first, &last);
+    for (k = first; k + 1 < last; k += 2) {
+        CVT_TYPE x0 = dst[k] + src[k] * gain;
+        CVT_TYPE x1 = dst[k+1] + src[k+1] * gain;
+        dst[k] = x0;
+        dst[k+1] = x1;
+    }
+    if (k < last) dst[k] += src[k] * gain;
+}
+
+
+void cvt_q15_to_f(CVT_TYPE *dst, const short *src, int n)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n, .scale = 1.0f / (1 << 15) };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), q15_to_f_core, &arg);
+}
+
+void cvt_q31_to_f(CVT_TYPE *dst, const int32_t *src, int n, int q)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n, .scale = 1.0f / (1 << q) };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), q31_to_f_core, &arg);
+}
+
+void cvt_f32_to_f(CVT_TYPE *dst, const float *src, int n)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), f32_to_f_core, &arg);
+}
+
+void cvt_f16_to_f(CVT_TYPE *dst, const float16 *src, int n)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), f16_to_f_core, &arg);
+}
+
+int cvt_f_to_q31(int32_t *dst, const CVT_TYPE *src, int n, int q, int headroom)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n, .scale = (float) (1 << q), .limit = (float) (1 << (q + headroom)) };
+    return fork_and_sum(f_to_q31_core, &arg);
+}
+
+int cvt_f_acc_q15(short *dst, const CVT_TYPE *src, int n, float gain)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n, .scale = gain * (1 << 15), .limit = (float) (1 << 15) };
+    return fork_and_sum(f_acc_q15_core, &arg);
+}
+
+void cvt_f_acc_f(CVT_TYPE *dst, const CVT_TYPE *src, int n, float gain)
+{
+    cvt_arg_t arg = { .dst = dst, .src = src, .n = n, .scale = gain };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), f_acc_f_core, &arg);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+
+
+// same datatype of the DSP buffers
+#ifdef DSP_BFLOAT16
+#define CVT_TYPE float16alt
+#else
+#define CVT_TYPE float16
+#endif
+
+/*
+ * Sample format conversions of the audio I/O
+ *
+ * To be called from the cluster master core, within the STFT/iSTFT/NN tasks:
+ * the samples are split among the cluster cores. The scaling is computed in
+ * float32, since the integer full scales exceed the float16 range, and the
+ * conversions to integers saturate to the full scale and return the number of
+ * clipped samples.
+ */
+
+/*
+ * \brief int16 (Q15) to CVT_TYPE, dst can be the same buffer of src
+ */
+void cvt_q15_to_f(CVT_TYPE *dst, const short *src, int n);
+
+/*
+ * \brief int32 (Q<q>) to CVT_TYPE
+ */
+void cvt_q31_to_f(CVT_TYPE *dst, const int32_t *src, int n, int q);
+
+/*
+ * \brief float32 to CVT_TYPE
+ */
+void cvt_f32_to_f(CVT_TYPE *dst, const float *src, int n);
+
+/*
+ * \brief float16 to CVT_TYPE (a copy if CVT_TYPE is float16)
+ */
+void cvt_f16_to_f(CVT_TYPE *dst, const float16 *src, int n);
+
+/*
+ * \brief CVT_TYPE to int32 (Q<q>), returns the samples beyond the full scale [-1, 1)
+ *
+ * headroom bits are kept above the full scale for a later stage (e.g. a limiter):
+ * the samples are saturated to [-2^headroom, 2^headroom), q + headroom <= 30.
+ */
+int cvt_f_to_q31(int32_t *dst, const CVT_TYPE *src, int n, int q, int headroom);
+
+/*
+ * \brief dst (int16, Q15) += src * gain, saturated, returns the clipped samples
+ *
+ * Overlap-and-add of an output frame onto the int16 samples of the previous ones.
+ */
+int cvt_f_acc_q15(short *dst, const CVT_TYPE *src, int n, float gain);
+
+/*
+ * \brief dst += src * gain
+ */
+void cvt_f_acc_f(CVT_TYPE *dst, const CVT_TYPE *src, int n, float gain);
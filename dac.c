@@ -23,56 +23,126 @@ static uint8_t read_reg8(pi_device_t *dev, uint8_t addr)
     return result;
 }
 
-int fxl6408_setup()
+/*
+    Power-up sequences: register writes and waits
+*/
+#define DAC_WRITE(addr, value)  { 0, (addr), (value), 0 }
+#define DAC_WAIT(us)            { 1, 0, 0, (us) }
+
+typedef struct {
+    uint8_t wait;
+    uint8_t addr;
+    uint8_t value;
+    uint32_t us;
+} dac_step_t;
+
+// GPIO expander: power-up of the ak4332
+static const dac_step_t fxl6408_seq[] = {
+    // wait Xms before ak4332 pwd, to stabilize supply voltage
+    DAC_WAIT(100000),
+    DAC_WRITE(0x01, 0x1),   // reset the GPIO expander
+    DAC_WRITE(0x03, 0x2),
+    DAC_WRITE(0x05, 0x2),
+    DAC_WRITE(0x07, 0x0),
+    // Wait at least 1ms after ak4332 power-up
+    DAC_WAIT(2000),
+};
+
+static const dac_step_t ak4332_seq[] = {
+    // DAC initial settings
+    DAC_WRITE(0x26, 0x02),
+    DAC_WRITE(0x27, 0xC0),
+    // program CM and FS
+    DAC_WRITE(0x05, 0b0001010),     // FS-48kHz
+    // PDM bit and PDMMODE (DSD)
+    DAC_WRITE(0x08, 0b101),
+    // Set HP Gain to 0
+    DAC_WRITE(0x0d, 0b101),
+    // Set DAC volume to max
+    DAC_WRITE(0x0b, 0x1F),
+    // Configure PLL to take BLCK/DSDCLK as input clock
+    DAC_WRITE(0x0E, 0x1),
+    // Configure DAC to take PLL as input clock
+    DAC_WRITE(0x13, 0x1),
+    // Configure DAC clock divider
+    DAC_WRITE(0x14, 0x1),
+    // PLD = 3, PLM = 31
+    DAC_WRITE(0x0F, 0),
+    DAC_WRITE(0x10, 3),
+    DAC_WRITE(0x11, 0),
+    DAC_WRITE(0x12, 31),
+    // set volume to max
+    DAC_WRITE(0x0b, 0x1f),
+    DAC_WRITE(0x0d, 0x7),
+    // Power-up PLL
+    DAC_WRITE(0x00, 0x1),
+    DAC_WAIT(20000),
+    // Power-up PMTIM
+    DAC_WRITE(0x00, 0x3),
+    // Power-up charge pump for both channels
+    DAC_WRITE(0x01, 0x1),
+    DAC_WAIT(65000),
+    // Power-up LDO1
+    DAC_WRITE(0x01, 0x31),
+    DAC_WAIT(5000),
+    // Power up charge pump 2
+    DAC_WRITE(0x01, 0x33),
+    // Power-up DAC
+    DAC_WRITE(0x02, 0x1),
+    // Power-up Amplifier
+    DAC_WRITE(0x03, 0x1),
+};
+
+#define SEQ_LEN(seq) (sizeof(seq) / sizeof(dac_step_t))
+
+static void run_seq(pi_device_t *dev, const dac_step_t *seq, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (seq[i].wait)
+            pi_time_wait_us(seq[i].us);
+        else
+            write_reg8(dev, seq[i].addr, seq[i].value);
+    }
+}
+
+static int open_fxl6408(pi_device_t *i2c)
 {
     // Setting pads 42 & 43 to Alternate 0 function to enable I2C1 peripheral
     pi_pad_set_function(PI_PAD_042,  PI_PAD_FUNC0);
     pi_pad_set_function(PI_PAD_043,  PI_PAD_FUNC0);
 
-    //printf("Testing fxl6408\n");
-    int errors = 0;
-    pi_device_t i2c;
     struct pi_i2c_conf conf;
     pi_i2c_conf_init(&conf);
     conf.itf = 1;
     pi_i2c_conf_set_slave_addr(&conf, 0x86, 0);
 
-    pi_open_from_conf(&i2c, &conf);
-    if (pi_i2c_open(&i2c))
-    {
-        return -1;
-    }
-
-    // wait Xms before ak4332 pwd, to stabilize supply voltage
-    pi_time_wait_us(100000);
-
-    // Turn-on ak4332
-    write_reg8(&i2c, 0x01, 0x1); // reset the GPIO expander
-
-    write_reg8(&i2c, 0x03, 0x2);
-    write_reg8(&i2c, 0x05, 0x2);
-    write_reg8(&i2c, 0x07, 0x0);
+    pi_open_from_conf(i2c, &conf);
+    return pi_i2c_open(i2c);
+}
 
-    pi_i2c_close(&i2c);
-    // Wait at least 1ms after ak4332 power-up
-    pi_time_wait_us(2000);
+static int open_ak4332(pi_device_t *i2c)
+{
+    struct pi_i2c_conf conf;
+    pi_i2c_conf_init(&conf);
+    conf.itf = 1;
+    conf.max_baudrate = 100000;
+    pi_i2c_conf_set_slave_addr(&conf, 0x20, 0);
 
-    return 0;
+    pi_open_from_conf(i2c, &conf);
+    return pi_i2c_open(i2c);
 }
 
-int setup_dac(uint8_t id)
+/* Choose the right ak4332 with I2C Mux */
+/* The I2C Mux is controlled by the GPIO A68 */
+static int open_i2c_mux(struct pi_device *gpio_ic_mux)
 {
-
-    /* Choose the right ak4332 with I2C Mux */
-    /* The I2C Mux is controlled by the GPIO A68 */
-    struct pi_device gpio_ic_mux;
     struct pi_gpio_conf gpio_conf = {0};
     pi_gpio_e gpio_pin_o = PI_GPIO_A68; 
 
     pi_gpio_conf_init(&gpio_conf);
-    pi_open_from_conf(&gpio_ic_mux, &gpio_conf);
+    pi_open_from_conf(gpio_ic_mux, &gpio_conf);
     gpio_conf.port = (gpio_pin_o & PI_GPIO_NUM_MASK) >> 5;
-    if ( pi_gpio_open(&gpio_ic_mux) )
+    if ( pi_gpio_open(gpio_ic_mux) )
     {
         printf("Error opening GPIO \n");
         return -2;
@@ -81,91 +151,132 @@ int setup_dac(uint8_t id)
     pi_gpio_flags_e cfg_flags_out = PI_GPIO_OUTPUT|PI_GPIO_PULL_DISABLE|PI_GPIO_DRIVE_STRENGTH_LOW;
 
     /* Configure gpio output. */
-    pi_gpio_pin_configure(&gpio_ic_mux, gpio_pin_o, cfg_flags_out);
+    pi_gpio_pin_configure(gpio_ic_mux, gpio_pin_o, cfg_flags_out);
+    return 0;
+}
 
+static void select_dac(struct pi_device *gpio_ic_mux, uint8_t id)
+{
     if (id) // Right channel
-        pi_gpio_pin_write(&gpio_ic_mux, gpio_pin_o, 1);
+        pi_gpio_pin_write(gpio_ic_mux, PI_GPIO_A68, 1);
     else    // Left channel
-        pi_gpio_pin_write(&gpio_ic_mux, gpio_pin_o, 0);
+        pi_gpio_pin_write(gpio_ic_mux, PI_GPIO_A68, 0);
+}
 
-    int errors = 0;
+int fxl6408_setup()
+{
     pi_device_t i2c;
-    struct pi_i2c_conf conf;
-    pi_i2c_conf_init(&conf);
-    conf.itf = 1;
-    conf.max_baudrate = 100000;
-    pi_i2c_conf_set_slave_addr(&conf, 0x20, 0);
-
-    pi_open_from_conf(&i2c, &conf);
-    if (pi_i2c_open(&i2c))
+    if (open_fxl6408(&i2c))
     {
         return -1;
     }
+    run_seq(&i2c, fxl6408_seq, SEQ_LEN(fxl6408_seq));
+    pi_i2c_close(&i2c);
+    return 0;
+}
 
-    // DAC initial settings
-    write_reg8(&i2c, 0x26, 0x02);
-    write_reg8(&i2c, 0x27, 0xC0);
-
-    // program CM and FS
-    write_reg8(&i2c, 0x5, 0b0001010); //FS-48kHz
-    // write_reg8(&i2c, 0x5, 0b0001001); //FS-44.1kHz
-
-    // PDM bit and PDMMODE (DSD)
-    write_reg8(&i2c, 0x8, 0b101);
-
-    //Set HP Gain to 0
-    write_reg8(&i2c, 0x0d, 0b101);
-    //Set DAC volume to max
-    write_reg8(&i2c, 0x0b, 0x1F);
-
-    // Configure PLL to take BLCK/DSDCLK as input clock
-    write_reg8(&i2c, 0x0E, 0x1);
-
-    // Configure DAC to take PLL as input clock
-    write_reg8(&i2c, 0x13, 0x1);
-
-    // Configure DAC clock divider
-    write_reg8(&i2c, 0x14, 0x1);
-
-    int pld = 3;
-    write_reg8(&i2c, 0x0F, pld >> 8);
-    write_reg8(&i2c, 0x10, pld & 0xff);
-    int plm = 31;
-    write_reg8(&i2c, 0x11, plm >> 8);
-    write_reg8(&i2c, 0x12, plm & 0xff);
-
-    // set volume to max
-    write_reg8(&i2c, 0x0b, 0x1f);
-    write_reg8(&i2c, 0x0d, 0x7);
-
-    // Power-up PLL
-    write_reg8(&i2c, 0x00, 0x1);
-
-    pi_time_wait_us(20000);
-
-    // Power-up PMTIM
-    write_reg8(&i2c, 0x00, 0x3);
-
-    // Power-up charge pump for both channels
-    write_reg8(&i2c, 0x01, 0x1);
+int setup_dac(uint8_t id)
+{
+    struct pi_device gpio_ic_mux;
+    if (open_i2c_mux(&gpio_ic_mux))
+    {
+        return -2;
+    }
+    select_dac(&gpio_ic_mux, id);
 
-    pi_time_wait_us(65000);
+    pi_device_t i2c;
+    if (open_ak4332(&i2c))
+    {
+        return -1;
+    }
+    run_seq(&i2c, ak4332_seq, SEQ_LEN(ak4332_seq));
+    pi_i2c_close(&i2c);
 
-    // Power-up LDO1
-    write_reg8(&i2c, 0x01, 0x31);
+    return 0;
+}
 
-    pi_time_wait_us(5000);
 
-    // Power up charge pump 2
-    write_reg8(&i2c, 0x01, 0x33);
+/*
+    Asynchronous bring-up: the same sequences are chained by the end of the
+    I2C transfers and by timed tasks, so the FC is free during the waits
+*/
+#define STAGE_FXL6408   (0)
+#define STAGE_DAC_0     (1)
+#define STAGE_DAC_1     (2)
+#define STAGE_SETTLE    (3)
+#define STAGE_DONE      (4)
 
-    // Power-up DAC
-    write_reg8(&i2c, 0x02, 0x1);
+static struct {
+    pi_device_t fxl_i2c;
+    pi_device_t dac_i2c;
+    struct pi_device gpio_ic_mux;
+    pi_task_t step_task;
+    pi_task_t *done;
+    int stage;
+    int step;
+    uint32_t settle_us;
+} bringup;
+static PI_L2 uint8_t bringup_buffer[2];
+
+static void bringup_step(void *arg)
+{
+    const dac_step_t *seq;
+    int len;
+    pi_device_t *dev;
+
+    if (bringup.stage == STAGE_FXL6408) {
+        seq = fxl6408_seq; len = SEQ_LEN(fxl6408_seq); dev = &bringup.fxl_i2c;
+    } else if (bringup.stage == STAGE_SETTLE) {
+        bringup.stage = STAGE_DONE;
+        pi_task_push_delayed_us(bringup.done, bringup.settle_us);
+        return;
+    } else {
+        seq = ak4332_seq; len = SEQ_LEN(ak4332_seq); dev = &bringup.dac_i2c;
+    }
 
-    // Power-up Amplifier
-    write_reg8(&i2c, 0x03, 0x1);
+    if (bringup.step == len) {
+        // next stage, the DAC selected by the I2C mux
+        bringup.stage++;
+        bringup.step = 0;
+        if (bringup.stage == STAGE_DAC_0 || bringup.stage == STAGE_DAC_1) {
+            select_dac(&bringup.gpio_ic_mux, bringup.stage - STAGE_DAC_0);
+        }
+        bringup_step(NULL);
+        return;
+    }
 
-    pi_i2c_close(&i2c);
+    const dac_step_t *s = &seq[bringup.step++];
+    pi_task_callback(&bringup.step_task, bringup_step, NULL);
+    if (s->wait) {
+        pi_task_push_delayed_us(&bringup.step_task, s->us);
+    } else {
+        bringup_buffer[0] = s->addr;
+        bringup_buffer[1] = s->value;
+        pi_i2c_write_async(dev, bringup_buffer, 2, PI_I2C_XFER_START | PI_I2C_XFER_STOP, &bringup.step_task);
+    }
+}
 
+int dac_bringup_start(pi_task_t *done, uint32_t settle_us)
+{
+    if (open_fxl6408(&bringup.fxl_i2c) || open_ak4332(&bringup.dac_i2c))
+    {
+        return -1;
+    }
+    if (open_i2c_mux(&bringup.gpio_ic_mux))
+    {
+        return -2;
+    }
+    bringup.done = done;
+    bringup.settle_us = settle_us;
+    bringup.stage = STAGE_FXL6408;
+    bringup.step = 0;
+    bringup_step(NULL);
     return 0;
 }
+
+void dac_bringup_end(void)
+{
+    pi_i2c_close(&bringup.fxl_i2c);
+    pi_i2c_close(&bringup.dac_i2c);
+    pi_gpio_close(&bringup.gpio_ic_mux);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include "pmsis.h"
 
 
 
@@ -9,4 +10,20 @@
  * \return 0 if successful, an error code otherwise
  */
 int setup_dac(uint8_t id);
-int fxl6408_setup(void);
\ No newline at end of file
+int fxl6408_setup(void);
+
+/*
+ * \brief power up the GPIO expander and the two DACs without blocking the FC
+ *
+ * Same sequences of fxl6408_setup, setup_dac(0) and setup_dac(1), chained by the
+ * end of the I2C transfers and by timed tasks. done is pushed settle_us after
+ * the last DAC is powered up.
+ *
+ * \return 0 if the devices are opened, an error code otherwise
+ */
+int dac_bringup_start(pi_task_t *done, uint32_t settle_us);
+
+/*
+ * \brief release the devices of the bring-up, once done has been pushed
+ */
+void dac_bringup_end(void);
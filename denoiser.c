@@ -16,8 +16,22 @@
 #include "wavIO.h" 
 
 // Autotiler NN functions
+#ifdef FFT_MIXED_RADIX
+#include "mixed_fft.h"      // native (non power-of-two) FFT size, tables included by mixed_fft.c
+#else
 #include "RFFTKernels.h"
+#ifdef DSP_BFLOAT16
+#include "WinLUT_bf16.def"  //load the input audio signal and compute the STFT
+#else
 #include "WinLUT_f16.def"   //load the input audio signal and compute the STFT
+#endif
+#endif
+#ifdef DSP_BFLOAT16
+#include <math.h>
+#endif
+#if NUM_BANDS > 0
+#include "BandLUT.def"      // band pooling/expansion tables (model/gen_band_lut.py)
+#endif
 
 
 // NN Model Header
@@ -31,13 +45,51 @@
     #endif
 #endif
 
+#ifdef DVFS
+    #include "dvfs.h"
+#endif
+
+#ifdef MODEL_SET
+    #include "model_set.h"
+#endif
+
+#if defined(WIENER) || defined(MODEL_SET_wiener)
+    #include "wiener.h"
+#endif
+
+#if IS_SFU == 0 && IS_INPUT_STFT == 0
+    #include "resampler.h"
+#endif
+
+#if IS_INPUT_STFT == 1
+    #include "stft_pack.h"
+#endif
+
+#ifdef LATENCY_PROBE
+    #include "latency_probe.h"
+    // impulses every LATENCY_PROBE_MS, at 90% of the full scale
+    #define LATENCY_PROBE_PERIOD ((LATENCY_PROBE_MS * SAMPLING_FREQ) / 1000)
+    #define LATENCY_PROBE_AMP    (29491)
+#endif
+
+#include "metrics.h"
+#include "trace.h"
+#include "l2_plan.h"
+#include "convert.h"
+#include "control.h"
+
+#define __XSTR(__s) __STR(__s)
+#define __STR(__s) #__s
+
 /* 
      global variables
 */
 struct pi_device DefaultRam; 
 struct pi_device* ram = &DefaultRam;
 
+#ifndef MODEL_SET
 AT_DEFAULTFLASH_FS_EXT_ADDR_TYPE __PREFIX(_L3_Flash) = 0;
+#endif
 
 #ifdef AUDIO_EVK
     // GPIO defines
@@ -52,12 +104,31 @@ static pi_fs_file_t * file[1];
 static struct pi_device fs;
 static struct pi_device flash;
 pi_device_t* i2c_slider;
-static PI_L2 uint16_t slider_value;
+static PI_L2 uint16_t slider_value;     // the mask is applied above CONTROL_SLIDER_THR
 
 // datatype for computation
+#ifdef DSP_BFLOAT16
+// bfloat16 keeps the float32 range: no overflow of the squared magnitudes on loud inputs
+#define DATATYPE_SIGNAL     float16alt
+#define DATATYPE_SIGNAL_INF float16alt
+#define SqrtF16(a) ((float16alt) sqrtf((float) (a)))
+// 8 bits mantissa: lower SNR expected on the STFT+iSTFT checksum
+#define ISTFT_SNR_THR       (100.0f)     // qsnr > 20db
+#else
 #define DATATYPE_SIGNAL     float16
 #define DATATYPE_SIGNAL_INF float16
 #define SqrtF16(a) __builtin_pulp_f16sqrt(a)
+#define ISTFT_SNR_THR       (1000.0f)    // qsnr > 30db
+#endif
+
+// inverse of the gain of the overlap-and-add of the Hanning analysis windows (FRAME_SIZE/FRAME_STEP overlapping frames)
+#define OLA_SCALE ((float) (2 * FRAME_STEP) / FRAME_SIZE)
+
+// the STFT magnitude scales with the window length: if the frame is shorter than
+// the one used for training, rescale the NN input to the expected range
+#if FRAME_SIZE != TRAIN_FRAME_SIZE
+    #define MAG_SCALE ((DATATYPE_SIGNAL) ((float) TRAIN_FRAME_SIZE / FRAME_SIZE))
+#endif
 
 
 #if IS_INPUT_STFT == 0 
@@ -71,6 +142,15 @@ static PI_L2 uint16_t slider_value;
     // L3 arrays to store input and output audio 
     static uint32_t inSig;
     static uint32_t outSig;
+    static uint32_t outSigFs;   // output at the sampling rate of the wav file, if resampled
+    // first hop of the current input frame, reference of the output hop completed by the frame
+    static short int *Metrics_Ref;
+    #ifdef METRICS_REF_WAV
+        // clean version of the input wav (L3), compared to the output hop by hop
+        static uint32_t refSig;
+        static int Ref_Samples;
+        static short int *Metrics_Clean;
+    #endif
 
     #ifdef CHECKSUM
         #include "golden_sample_0000.h"
@@ -88,6 +168,13 @@ static PI_L2 uint16_t slider_value;
 
     // allocate space to load the input signal
     char *WavName = NULL;
+
+    // packed STFT frames (stft_pack.h) read in chunks of STFT_CHUNK_FRAMES (l2_plan.h), double buffered
+    // (sized as float32: aligned for the widest frames)
+    static float *Stft_Chunk[2];
+    // current frame of the chunk, converted to STFT_Magnitude by the NN task
+    static char *Stft_Frame;
+    static int Stft_Frame_Dtype;
     #ifdef CHECKSUM
         #include "golden_sample_0000.h"
         float error;
@@ -99,64 +186,116 @@ static PI_L2 uint16_t slider_value;
 #endif
 
 
+#include "STFTConfig.h"      // framing and datatype of the generated STFT files (stft_model.mk)
+#if STFT_CFG_FRAME_SIZE != FRAME_SIZE || STFT_CFG_FRAME_STEP != FRAME_STEP || STFT_CFG_NFFT != FRAME_NFFT \
+    || defined(STFT_CFG_BFLOAT16) != defined(DSP_BFLOAT16)
+    #error "The generated STFT files do not match the FRAME_SIZE/FRAME_STEP/FRAME_NFFT/datatype settings: run make clean"
+#endif
+
 /* 
-    static allocation of temporary buffers
+    temporary buffers, in the persistent block of the L2 arena (l2_plan.h)
 */
-PI_L2 DATATYPE_SIGNAL Audio_Frame[FRAME_NFFT];  // stores the clip to compute the STFT. only first FRAME_SIZE samples (<FRAME_NFFT) are valid
-PI_L2 DATATYPE_SIGNAL STFT_Spectrogram[AT_INPUT_WIDTH*AT_INPUT_HEIGHT*2]; // the 2 is because of complex numbers
-PI_L2 DATATYPE_SIGNAL STFT_Magnitude[AT_INPUT_WIDTH*AT_INPUT_HEIGHT];     // magnitude of the precedent vectors, used as denoiser input and output
+static DATATYPE_SIGNAL *Audio_Frame;        // stores the clip to compute the STFT. only first FRAME_SIZE samples (<FRAME_NFFT) are valid
+static DATATYPE_SIGNAL *STFT_Spectrogram;   // STFT_BINS*AT_INPUT_HEIGHT complex numbers
+static DATATYPE_SIGNAL *STFT_Magnitude;     // magnitude of the precedent vectors, used as denoiser input and output
+
+#if NUM_BANDS > 0
+    #if BAND_LUT_BINS != STFT_BINS || BAND_LUT_BANDS != NUM_BANDS
+        #error "BandLUT.def does not match the STFT_BINS/NUM_BANDS settings: run make clean"
+    #endif
+    // every bin is shared between the band BandIdxLUT[k] (weight BandWeightLUT[k]) and the next one (1-weight)
+    PI_L2 unsigned char BandIdxLUT[STFT_BINS] = BAND_IDX_LUT;
+    PI_L2 DATATYPE_SIGNAL BandWeightLUT[STFT_BINS] = BAND_WEIGHT_LUT;
+    PI_L2 DATATYPE_SIGNAL BandNormLUT[NUM_BANDS] = BAND_NORM_LUT;
+    static DATATYPE_SIGNAL *Band_Magnitude;    // band energies as denoiser input, band mask as output
+    #define NN_BUFFER Band_Magnitude
+#else
+    #define NN_BUFFER STFT_Magnitude
+#endif
 
 #if IS_SFU == 1 
-PI_L2 DATATYPE_SIGNAL Audio_Frame_temp[FRAME_SIZE];
+static DATATYPE_SIGNAL *Audio_Frame_temp;
 #else 
-PI_L2 short int Audio_Frame_temp[FRAME_SIZE];
+static short int *Audio_Frame_temp;
 #endif //IS_INPUT_STFT == 0 && IS_SFU == 0
 
+#if IS_INPUT_STFT == 0
+// I/O of the hop, converted by the cluster in the STFT/iSTFT tasks (convert.h)
+#if IS_SFU == 1
+static int32_t *Sfu_In_Chunk;   // Q<SFU_IN_Q> input chunk, NULL to slide in silence
+static int32_t *Sfu_Out_Chunk;  // Q<SFU_OUT_Q> output chunk of the hop completed by the previous frame
+static float Out_Gain = 1.0f;   // output gain of the control plane
+static control_params_t Params; // runtime parameters of the current hop
+static void SfuHopIO();
+#else
+static short *Input_Q15;        // input frame, can be Audio_Frame itself (converted in place)
+#endif
+static int Io_Clipped;          // output samples saturated by the last task
+#endif
+
 PI_L2 int ResetLSTM;
 
-// RNN states statically allocated to preserve the values during time
+#if IS_SFU == 1
+// mask applied by RunDenoiser: the hops processed late skip the inference (see SFU_OVERRUN)
+#define MASK_NN             (0)     // computed by the NN
+#define MASK_PREVIOUS       (1)     // last mask computed by the NN
+#define MASK_NONE           (2)     // no filtering
+static int Mask_Mode;
+static DATATYPE_SIGNAL *Previous_Mask;
+#endif
+
+// quality metrics, reported at the end of the run and every METRICS_REPORT_HOPS hops (if not 0)
+static metrics_t Metrics;
+
+#ifdef MODEL_SET
+// the models of the set keep their own states (model_entry.h)
+extern model_entry_t denoiser_dns_Entry, denoiser_GRU_Entry, denoiser_Entry, wiener_Entry;
+#else
+// RNN states in the persistent block of the L2 arena to preserve the values during time
 // note that, for simplicity we left the rnn states to be 16 bits variables even if quantized to 8 bits
 #define RNN_STATE_DIM_0 (H_STATE_LEN) 
 #define RNN_STATE_DIM_1 (H_STATE_LEN)
-PI_L2 DATATYPE_SIGNAL_INF RNN_STATE_0_I[RNN_STATE_DIM_0];
-PI_L2 DATATYPE_SIGNAL_INF RNN_STATE_1_I[RNN_STATE_DIM_1];
+static DATATYPE_SIGNAL_INF *RNN_STATE_0_I;
+static DATATYPE_SIGNAL_INF *RNN_STATE_1_I;
 #ifndef GRU
-PI_L2 DATATYPE_SIGNAL_INF RNN_STATE_0_C[RNN_STATE_DIM_0];
-PI_L2 DATATYPE_SIGNAL_INF RNN_STATE_1_C[RNN_STATE_DIM_1];
+static DATATYPE_SIGNAL_INF *RNN_STATE_0_C;
+static DATATYPE_SIGNAL_INF *RNN_STATE_1_C;
+#endif
 #endif
 
+#ifdef PERF
+// cycles accumulated over the processed frames, reported at the end of the run (64 bits: long files)
+// STFT and iSTFT cover the same scope: sample conversion, transform and magnitude / overlap-and-add
+PI_L2 uint64_t STFT_Cycles_Acc;
+PI_L2 uint64_t iSTFT_Cycles_Acc;
+#if !defined(DISABLE_NN_INFERENCE) && !defined(MODEL_SET) && !defined(WIENER)
+PI_L2 uint64_t AT_GraphPerf_Acc[sizeof(AT_GraphPerf)/sizeof(unsigned int)];
+#endif
+#ifdef WIENER
+PI_L2 uint64_t Wiener_Cycles_Acc;
+#endif
+static int Perf_Frames;
+#endif
 
-static uint16_t ads1014_read(pi_device_t *dev, uint8_t addr)
-{
-    uint16_t result;
-    pi_i2c_write(dev, &addr, 1, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
-    pi_i2c_read(dev, (uint8_t *)&result, 2, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
-    result = (result << 8) | (result >> 8);
-    return result;
-}
-
-static int ads1014_write(pi_device_t *dev, uint8_t addr, uint16_t value)
-{
-    uint8_t buffer[3] = { addr, value >> 8, value & 0xFF };
-    return pi_i2c_write(dev, buffer, 3, PI_I2C_XFER_START | PI_I2C_XFER_STOP);
-}
-
-int init_ads1014(pi_device_t *i2c)
-{
-    struct pi_i2c_conf conf;
-    pi_i2c_conf_init(&conf);
-    conf.itf = 1;
-    pi_i2c_conf_set_slave_addr(&conf, 0x90, 0);
 
-    pi_open_from_conf(i2c, &conf);
-    if (pi_i2c_open(i2c)) return -1;
 
-    uint16_t expected = (1 << 15) | (0 << 12) | (2 << 9) | (7 << 5) | 3;
-    ads1014_write(i2c, 1, expected);
 
-    return 0;
+#if NUM_BANDS > 0
+/*
+    Band compression: weighted average of the bin magnitudes of every band
+*/
+static void BandPool()
+{
+    for (int b=0; b<NUM_BANDS; b++) Band_Magnitude[b] = (DATATYPE_SIGNAL) 0.0f;
+    for (int k=0; k<STFT_BINS; k++){
+        int b = BandIdxLUT[k];
+        DATATYPE_SIGNAL w = BandWeightLUT[k];
+        Band_Magnitude[b]   += w * STFT_Magnitude[k];
+        Band_Magnitude[b+1] += ((DATATYPE_SIGNAL) 1.0f - w) * STFT_Magnitude[k];
+    }
+    for (int b=0; b<NUM_BANDS; b++) Band_Magnitude[b] *= BandNormLUT[b];
 }
-
+#endif
 
 /*
     STFT computation
@@ -170,9 +309,26 @@ static void RunSTFT()
 #endif
     unsigned int ta = gap_cl_readhwtimer();
 
+#if IS_INPUT_STFT == 0
+    // input hop to DATATYPE_SIGNAL
+#if IS_SFU == 1
+    SfuHopIO();
+#else
+    cvt_q15_to_f(Audio_Frame, Input_Q15, FRAME_SIZE);
+#endif
+    PRINTF("Audio In: ");
+    for (int i= 0 ; i<FRAME_SIZE; i++){
+        PRINTF("%f, ", Audio_Frame[i] );
+    }
+    PRINTF("\n");
+#endif
+
     // compute the STFT 
     //      input: Audio Frame (FRAME_SIZE): 16 bits from the microphone or file
     //      output: STFT_Spectrogram, DATATYPE_SIGNAL as output (e.g. float16)
+#ifdef FFT_MIXED_RADIX
+    MixedRFFT(Audio_Frame, STFT_Spectrogram);
+#else
     STFT(
         Audio_Frame, 
         STFT_Spectrogram, 
@@ -181,21 +337,32 @@ static void RunSTFT()
         SwapTable,
         WindowLUT
     );
+#endif
 
     unsigned int ti = gap_cl_readhwtimer() - ta;
     PRINTF("%45s: Cycles: %10d\n","STFT: ", ti );
 
     ta = gap_cl_readhwtimer();
     // compute the magnitude of the STFT components
-    for (int i=0; i<AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++){
+    for (int i=0; i<STFT_BINS*AT_INPUT_HEIGHT; i++){
         DATATYPE_SIGNAL STFT_Real_Part = STFT_Spectrogram[2*i];
         DATATYPE_SIGNAL STFT_Imag_Part = STFT_Spectrogram[2*i+1];
         DATATYPE_SIGNAL STFT_Squared = STFT_Real_Part*STFT_Real_Part + STFT_Imag_Part*STFT_Imag_Part ;
+#ifdef MAG_SCALE
+        STFT_Magnitude[i] = SqrtF16 (STFT_Squared) * MAG_SCALE;
+#else
         STFT_Magnitude[i] = SqrtF16 (STFT_Squared);
+#endif
     }
+#if NUM_BANDS > 0
+    BandPool();
+#endif
     ti = gap_cl_readhwtimer() - ta;
 
     PRINTF("%45s: Cycles: %10d\n","Magnitude Compute: ", ti );
+#ifdef PERF
+    STFT_Cycles_Acc += gap_cl_readhwtimer();
+#endif
 }
 
 /*
@@ -216,6 +383,9 @@ static void RuniSTFT()
     //      input: STFT_Spectrogram: DATATYPE_SIGNAL
     //      output: STFT_Spectrogram, DATATYPE_SIGNAL - reusing the same buffer
     ta = gap_cl_readhwtimer();
+#ifdef FFT_MIXED_RADIX
+    MixedIRFFT(STFT_Spectrogram, STFT_Spectrogram);
+#else
     iSTFT(
         STFT_Spectrogram, 
         STFT_Spectrogram, 
@@ -223,8 +393,20 @@ static void RuniSTFT()
         RFFTTwiddlesLUT,   
         SwapTable
     );
+#endif
     ti = gap_cl_readhwtimer() - ta;
     PRINTF("%45s: Cycles: %10d\n","iSTFT: ", ti );
+
+    // overlap and add of the output frame
+#if IS_SFU == 1
+    cvt_f_acc_f(Audio_Frame_temp, STFT_Spectrogram, FRAME_SIZE, OLA_SCALE * Out_Gain);
+#elif IS_INPUT_STFT == 0
+    // onto the previous Q15 output frame, read by the FC before the task
+    Io_Clipped = cvt_f_acc_q15(Audio_Frame_temp, STFT_Spectrogram, FRAME_SIZE, OLA_SCALE);
+#endif
+#ifdef PERF
+    iSTFT_Cycles_Acc += gap_cl_readhwtimer();
+#endif
 }
 
 /*
@@ -236,20 +418,47 @@ static void RunDenoiser()
     PRINTF("Running on cluster\n");
 
 #   ifdef PERF
-    unsigned int ta, ti;
+    unsigned int ta = 0, ti;
     gap_cl_starttimer();
     gap_cl_resethwtimer();
 #   endif
 
+#if IS_INPUT_STFT == 1
+    // packed STFT frame to the NN input
+    if (Stft_Frame_Dtype == STFT_PACK_FLOAT16) {
+        cvt_f16_to_f(STFT_Magnitude, (float16 *) Stft_Frame, STFT_BINS*AT_INPUT_HEIGHT);
+    } else {
+        cvt_f32_to_f(STFT_Magnitude, (float *) Stft_Frame, STFT_BINS*AT_INPUT_HEIGHT);
+    }
+#if NUM_BANDS > 0
+    BandPool();
+#endif
+#endif
+
     /* Denoiser NN computation
-          input: STFT_Magnitude: DATATYPE_SIGNAL, 
-          output: STFT_Magnitude, DATATYPE_SIGNAL - reusing the same buffer
+          input: NN_BUFFER (STFT_Magnitude or Band_Magnitude): DATATYPE_SIGNAL, 
+          output: NN_BUFFER, DATATYPE_SIGNAL - reusing the same buffer
           states: RNN_STATE_0_I, RNN_STATE_0_C, RNN_STATE_1_I, RNN_STATE_1_C, must be preserved
           reset: only enabled at the start of the application
     */
+#if IS_SFU == 1
+    if (Mask_Mode == MASK_NONE) return;
+    if (Mask_Mode == MASK_PREVIOUS) {
+        for (int i = 0; i < STFT_BINS*AT_INPUT_HEIGHT; i++) STFT_Magnitude[i] = Previous_Mask[i];
+    } else {
+#endif
 #ifdef AUDIO_EVK
         pi_gpio_pin_write(&gpio_port, gpio_pin_o, 1);
 #endif
+#if defined(WIENER)
+    // classical suppression in place of the NN, same mask format
+    wiener_run(NN_BUFFER, ResetLSTM);
+#   ifdef PERF
+    Wiener_Cycles_Acc += gap_cl_readhwtimer();
+#   endif
+#elif defined(MODEL_SET)
+    model_set_run(NN_BUFFER, ResetLSTM);
+#else
     __PREFIX(CNN)(
 #   ifndef GRU
         RNN_STATE_1_C,
@@ -257,11 +466,12 @@ static void RunDenoiser()
 #   endif
         RNN_STATE_1_I,
         RNN_STATE_0_I,        
-        STFT_Magnitude,  
+        NN_BUFFER,  
         ResetLSTM, 
         ResetLSTM, 
-        STFT_Magnitude
+        NN_BUFFER
     );
+#endif
 #ifdef AUDIO_EVK
         pi_gpio_pin_write(&gpio_port, gpio_pin_o, 0);
 #endif
@@ -274,10 +484,22 @@ static void RunDenoiser()
     #   ifdef PERF
     ta = gap_cl_readhwtimer();
     #endif
-    for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
+#if NUM_BANDS > 0
+    // expand the band mask to the bins (linear interpolation between adjacent bands)
+    for (int k = 0; k < STFT_BINS; k++){
+        int b = BandIdxLUT[k];
+        DATATYPE_SIGNAL w = BandWeightLUT[k];
+        STFT_Magnitude[k] = w * Band_Magnitude[b] + ((DATATYPE_SIGNAL) 1.0f - w) * Band_Magnitude[b+1];
+    }
+#endif
+#if IS_SFU == 1
+        for (int i = 0; i < STFT_BINS*AT_INPUT_HEIGHT; i++) Previous_Mask[i] = STFT_Magnitude[i];
+    }
+#endif
+    for (int i = 0; i< STFT_BINS*AT_INPUT_HEIGHT; i++ ){
         //#ifdef AUDIO_EVK
         
-        if(slider_value>28000){
+        if(slider_value>CONTROL_SLIDER_THR){
         //#endif
             STFT_Spectrogram[2*i]    = STFT_Spectrogram[2*i]   * STFT_Magnitude[i];
             STFT_Spectrogram[2*i+1]  = STFT_Spectrogram[2*i+1] * STFT_Magnitude[i];
@@ -299,17 +521,56 @@ static void RunDenoiser()
 
     #include "GraphINOUT_L2_Descr.h"
     #include "SFU_RT.h"
+    #include "chunk_ring.h"
+    #include "dac.h"
 
-    // FIXME: to tune it!!
-    #define Q_BIT_IN 27
-    #define Q_BIT_OUT (Q_BIT_IN-3)
+    // fixed point format of the chunks, set in the Makefile: the output graph (Graph.src) applies
+    // the gain, the saturation and the limiter on the SFU_OUT_HEADROOM bits above the full scale
+    #if SFU_IN_Q < SFU_OUT_Q
+        #error "the passthrough needs SFU_IN_Q >= SFU_OUT_Q"
+    #endif
 
-    #define BUFF_SIZE (FRAME_STEP*4)
-    #define CHUNK_NUM (8)
+    // BUFF_SIZE and CHUNK_NUM of the chunks: l2_plan.h
 
     //This should be equal to FRAME_SIZE/FRAME_STEP + 1
     #define STRUCT_DELAY (1)
 
+    // output hops buffered before being played
+    #define LATENCY_BUFFER_HOPS (STRUCT_DELAY)
+    // number of hops between two latency reports
+    #define LATENCY_REPORT_HOPS (4096)
+
+    // processing of the hops when the loop falls behind the microphone by SFU_BACKLOG hops:
+    //   DROP:      the late hops are skipped, their output is the tail of the overlap-and-add
+    //   CONCEAL:   the late hops are filtered with the previous mask, without inference
+    //   CATCHUP:   the late hops bypass the inference and the filtering
+    // the chunks overwritten by the uDMA before being read are always dropped
+    #define SFU_OVERRUN_DROP    (0)
+    #define SFU_OVERRUN_CONCEAL (1)
+    #define SFU_OVERRUN_CATCHUP (2)
+    #ifndef SFU_OVERRUN
+    #define SFU_OVERRUN SFU_OVERRUN_CONCEAL
+    #endif
+    #ifndef SFU_BACKLOG
+    #define SFU_BACKLOG (2)
+    #endif
+
+    static int chunk_in_cnt;
+    // completed input chunks, from the uDMA callback to the processing loop
+    static chunk_ring_t Chunk_Ring;
+    // the input chunks are copied to the output by the callback until the model is constructed
+    static volatile int Passthrough;
+    // DAC bring-up: 1 settled (callback), 2 enabled by the loop, 3 startup reported
+    static volatile int Codec_Ready;
+
+    // wait after the power-up of the DACs
+    #define DAC_SETTLE_US (100000)
+
+    static void handle_codec_ready(void *arg)
+    {
+        Codec_Ready = 1;
+    }
+
     #define SAI_ITF_IN         (1)
     #define SAI_ITF_OUT        (2)
 
@@ -363,14 +624,21 @@ static void RunDenoiser()
         return 0;
     }
 
-    static int chunk_in_cnt;
 
 
 
     static void handle_sfu_in_0_end(void *arg)
     {
-        
-        if(chunk_in_cnt==STRUCT_DELAY){
+        uint32_t seq = chunk_ring_push(&Chunk_Ring);
+
+        if (Passthrough) {
+            // same slot and scaling of the processed hop
+            int32_t *in = (int32_t *) BufferInList[seq % CHUNK_NUM];
+            int32_t *out = (int32_t *) BufferOutList[seq % CHUNK_NUM];
+            for (int i = 0; i < FRAME_STEP; i++) out[i] = in[i] >> (SFU_IN_Q - SFU_OUT_Q);
+        }
+
+        if(seq==STRUCT_DELAY){
             //pi_time_wait_us(5000);
             SFU_Enqueue_uDMA_Channel_Multi(ChanOutCtxt_0, CHUNK_NUM, BufferOutList, BUFF_SIZE, 0);
             SFU_GraphResetInputs(&SFU_RTD(GraphINOUT));
@@ -379,14 +647,197 @@ static void RunDenoiser()
             pi_task_push(&proc_task);
     }
 
+    /*
+        Hop I/O on the cluster, before the STFT (or alone for the dropped hops):
+        output of the hop completed by the previous frame, slide of the frames
+        and input of the new hop
+    */
+    static void SfuHopIO()
+    {
+        // the samples beyond the full scale are left to the limiter of the graph
+        Io_Clipped = cvt_f_to_q31(Sfu_Out_Chunk, Audio_Frame_temp, FRAME_STEP, SFU_OUT_Q, SFU_OUT_HEADROOM);
+
+        for(int i=0;i<FRAME_SIZE-FRAME_STEP;i++){
+            Audio_Frame[i] = Audio_Frame[i+FRAME_STEP];
+            Audio_Frame_temp[i] = Audio_Frame_temp[i+FRAME_STEP];
+        }
+
+        if (Sfu_In_Chunk) {
+            cvt_q31_to_f(Audio_Frame + FRAME_SIZE - FRAME_STEP, Sfu_In_Chunk, FRAME_STEP, SFU_IN_Q);
+        }
+        for(int i=0;i<FRAME_STEP;i++){
+            if (!Sfu_In_Chunk) Audio_Frame[i+FRAME_SIZE-FRAME_STEP] = (DATATYPE_SIGNAL) 0.0f;
+            Audio_Frame_temp[i+FRAME_SIZE-FRAME_STEP] = (DATATYPE_SIGNAL) 0.0f;
+        }
+    }
+
+#else
+    #define LATENCY_BUFFER_HOPS (0)
 #endif // IS_SFU == 1 
 
 
+#if IS_SFU == 0 && IS_INPUT_STFT == 0
+/*
+    Resampling of the wav files not sampled at SAMPLING_FREQ
+        the input is converted hop by hop when the frame slides and every
+        completed output hop is converted back to the rate of the wav file
+*/
+static resampler_t Rs_In, Rs_Out;
+static int Rs_In_Pos, Rs_Out_Pos;           // samples read from / written to the L3 buffers
+static short int *Resampled_Frame;
+static short int *Resampled_Out;
+static struct pi_cluster_task Rs_Task;
+
+typedef struct {
+    resampler_t *rs;
+    int n_in;
+    short *out;
+    int n_out;
+} resample_task_arg_t;
+
+static void RunResampler(void *arg)
+{
+    resample_task_arg_t *a = (resample_task_arg_t *) arg;
+    resampler_run(a->rs, a->n_in, a->out, a->n_out);
+}
+
+static void Resample(struct pi_device *cluster, resampler_t *rs, int n_in, short *out, int n_out)
+{
+    resample_task_arg_t arg = { rs, n_in, out, n_out };
+    pi_cluster_task(&Rs_Task, &RunResampler, &arg);
+    pi_cluster_send_task_to_cl(cluster, &Rs_Task);
+}
+
+// next n_out samples at SAMPLING_FREQ of the wav signal stored in L3, zero padded after the end of the file
+static void ResampleInput(struct pi_device *cluster, uint32_t wav, int wav_samples, short *out, int n_out)
+{
+    int n_in = resampler_in_needed(&Rs_In, n_out);
+    int n_read = wav_samples - Rs_In_Pos;
+    if (n_read > n_in) n_read = n_in;
+    if (n_read > 0)
+        pi_ram_read(&DefaultRam, wav + Rs_In_Pos * sizeof(short), Rs_In.in, n_read * sizeof(short));
+    else
+        n_read = 0;
+    for (int i = n_read; i < n_in; i++) Rs_In.in[i] = 0;
+    Rs_In_Pos += n_in;
+
+    Resample(cluster, &Rs_In, n_in, out, n_out);
+}
+
+// convert n_in output samples (silence if in is NULL) and append them to the wav signal stored in L3
+static void ResampleOutput(struct pi_device *cluster, uint32_t wav, int wav_samples, short *in, int n_in)
+{
+    for (int i = 0; i < n_in; i++) Rs_Out.in[i] = (in == NULL) ? 0 : in[i];
+    int n_out = resampler_out_avail(&Rs_Out, n_in);
+    Resample(cluster, &Rs_Out, n_in, Resampled_Out, n_out);
+
+    if (Rs_Out_Pos + n_out > wav_samples) n_out = wav_samples - Rs_Out_Pos;
+    if (n_out > 0) {
+        pi_ram_write(&DefaultRam, wav + Rs_Out_Pos * sizeof(short), Resampled_Out, n_out * sizeof(short));
+        Rs_Out_Pos += n_out;
+    }
+}
+#endif // IS_SFU == 0 && IS_INPUT_STFT == 0
+
+
+#if IS_INPUT_STFT == 0
+/*
+    Latency report
+        algorithmic: a sample is released once its last overlapping frame has been
+        processed (FRAME_SIZE) and after the output buffering
+        processing: worst case measured time from the input hop to the output hop
+*/
+static unsigned int Proc_Us_Max;
+
+// hop period, i.e. the deadline to process a frame in real-time
+#define HOP_US ((unsigned int) (((unsigned long long) FRAME_STEP * 1000000) / SAMPLING_FREQ))
+
+// output hops buffered before the DAC in the SFU mode (STRUCT_DELAY), added to the latency of the file modes
+#define LATENCY_SFU_OUT_HOPS (1)
+
+#ifdef LATENCY_BUDGET_US
+// bound of every mode: the frame and the output hop buffered before the DAC
+#if (((FRAME_SIZE + LATENCY_SFU_OUT_HOPS * FRAME_STEP) * 1000000LL) / SAMPLING_FREQ) > LATENCY_BUDGET_US
+    #error "The frame and hop latency exceeds LATENCY_BUDGET_US"
+#endif
+#endif
+
+#if IS_SFU == 0
+// latency of the I/O chain out of the loop: group delay of the wav resamplers
+static unsigned int IoLatencyUs(void)
+{
+    return resampler_delay_us(WAV_FS, SAMPLING_FREQ) + resampler_delay_us(SAMPLING_FREQ, WAV_FS);
+}
+#endif
+
+// returns the algorithmic latency in us, with the I/O chain
+static unsigned int PrintLatency(void)
+{
+    unsigned int algo_samples = FRAME_SIZE + LATENCY_BUFFER_HOPS * FRAME_STEP;
+    unsigned int algo_us = (unsigned int) (((unsigned long long) algo_samples * 1000000) / SAMPLING_FREQ);
+
+#if IS_SFU == 1
+    // the PDM filters and resamplers of the SFU graph are not accounted
+    printf("Latency: algorithmic %d samples (%d us), processing max %d us (hop %d us), mic-to-DAC %d us\n",
+        algo_samples, algo_us, Proc_Us_Max, HOP_US, algo_us + Proc_Us_Max);
+#else
+    unsigned int io_us = IoLatencyUs();
+    algo_us += io_us;
+    printf("Latency: algorithmic %d samples + resamplers %d us (%d us), processing max %d us (hop %d us), input-to-output of the loop %d us\n",
+        algo_samples, io_us, algo_us, Proc_Us_Max, HOP_US, algo_us + Proc_Us_Max);
+#endif
+    return algo_us;
+}
+#endif
+
+/*
+    Startup report: time from the entry in denoiser() to the end of the model
+    construction, to the end of the codec bring-up (SFU mode) and to the first
+    hop filtered by the NN
+*/
+static unsigned int Start_Us, Construct_Us, Codec_Us, First_Hop_Us;
+
+static void PrintStartup(void)
+{
+#if IS_SFU == 1
+    printf("Startup: model constructed at %d us, codec ready at %d us, first denoised hop at %d us\n",
+        Construct_Us, Codec_Us, First_Hop_Us);
+#else
+    printf("Startup: model constructed at %d us, first denoised hop at %d us\n", Construct_Us, First_Hop_Us);
+#endif
+}
+
+/*
+    Lifetime plan of the L2 buffers of the application (l2_plan.h), the bounds
+    of the SDK types accounted on the host must hold
+*/
+static l2_buffer_t L2_Plan[L2_BUFFERS];
+
+_Static_assert(sizeof(DATATYPE_SIGNAL) == L2_SIGNAL_BYTES && sizeof(DATATYPE_SIGNAL_INF) == L2_SIGNAL_BYTES,
+    "L2_SIGNAL_BYTES does not match the DSP datatype");
+_Static_assert(sizeof(struct pi_cluster_task) <= L2_CLUSTER_TASK_BYTES, "L2_CLUSTER_TASK_BYTES too small");
+#if IS_SFU == 1
+_Static_assert(sizeof(void *) == L2_POINTER_BYTES, "L2_POINTER_BYTES does not match the target");
+_Static_assert(sizeof(pi_device_t) <= L2_DEVICE_BYTES, "L2_DEVICE_BYTES too small");
+_Static_assert(sizeof(SFU_uDMA_Channel_T) <= L2_SFU_CHANNEL_BYTES, "L2_SFU_CHANNEL_BYTES too small");
+#endif
+
+#ifdef MODEL_SET
+/*
+    Time left to the NN: MODEL_BUDGET_PCT of the hop period minus the rest of the processing
+*/
+static unsigned int ModelBudget(unsigned int other_us)
+{
+    unsigned int budget_us = (HOP_US * MODEL_BUDGET_PCT) / 100;
+    return (budget_us > other_us) ? budget_us - other_us : 0;
+}
+#endif
 
 
 
 void denoiser(void)
 {
+    Start_Us = pi_time_get_us();
     printf("Entering main controller\n");
 
         /****
@@ -463,6 +914,17 @@ void denoiser(void)
         pmsis_exit(-4);
     }
     pi_freq_set(PI_FREQ_DOMAIN_CL, FREQ_CL*1000*1000);
+#ifdef DVFS
+    // FREQ_CL is only the starting point, the governor adapts it to the measured load
+    dvfs_init(FREQ_CL);
+#endif
+
+    l2_plan_init(L2_Plan);
+    if (l2_arena_open(L2_Plan, L2_BUFFERS))
+    {
+        printf("Error when allocating the L2 arena\n");
+        pmsis_exit(18);
+    }
 
 
 
@@ -475,6 +937,7 @@ void denoiser(void)
     int Status;
     int Trace = 0;
     pi_task_block(&proc_task);
+    chunk_ring_reset(&Chunk_Ring, CHUNK_NUM);
 
     // Drive pad with 12 mAP to have less noise
     uint32_t *Magic_Setting_0 = (uint32_t *)0x1A104064;
@@ -492,15 +955,15 @@ void denoiser(void)
 
     StartSFU(FREQ_SFU*1000*1000, 1);
 
-    ChanInCtxt_0   = (SFU_uDMA_Channel_T *) pi_l2_malloc(sizeof(SFU_uDMA_Channel_T));
-    ChanOutCtxt_0  = (SFU_uDMA_Channel_T *) pi_l2_malloc(sizeof(SFU_uDMA_Channel_T));
+    ChanInCtxt_0   = (SFU_uDMA_Channel_T *) l2_arena_get(L2_SFU_CHANNELS);
+    ChanOutCtxt_0  = ChanInCtxt_0 + 1;
     
     
-    BufferInList = (void*) pi_l2_malloc(sizeof(void*)*CHUNK_NUM);
-    for(int i=0;i<CHUNK_NUM;i++) BufferInList[i]=pi_l2_malloc(BUFF_SIZE);
+    BufferInList = (void **) l2_arena_get(L2_SFU_LISTS);
+    for(int i=0;i<CHUNK_NUM;i++) BufferInList[i]=(char *) l2_arena_get(L2_SFU_IN) + i*BUFF_SIZE;
     
-    BufferOutList = (void*)pi_l2_malloc(sizeof(void*)*CHUNK_NUM);
-    for(int i=0;i<CHUNK_NUM;i++) BufferOutList[i]=pi_l2_malloc(BUFF_SIZE);;
+    BufferOutList = BufferInList + CHUNK_NUM;
+    for(int i=0;i<CHUNK_NUM;i++) BufferOutList[i]=(char *) l2_arena_get(L2_SFU_OUT) + i*BUFF_SIZE;
 
 
     // Get uDMA channels for GraphIN
@@ -530,20 +993,32 @@ void denoiser(void)
 
     
 
-    fxl6408_setup();
-
-    // Setup 2 DAC
-    if(setup_dac(0) || setup_dac(1))
+    // the power-up of the GPIO expander and of the 2 DACs (about 400 ms of waits) runs
+    // in background, while the audio flows in passthrough and the model is constructed
+    pi_task_t codec_task;
+    Codec_Ready = 0;
+    if (dac_bringup_start(pi_task_callback(&codec_task, handle_codec_ready, NULL), DAC_SETTLE_US))
     {
         printf("Failed to setup DAC\n");
         pmsis_exit(-1);
     }
-    pi_time_wait_us(100000);
-    //printf("Setup DAC OK\n"); 
+    Passthrough = 1;
+    SFU_StartGraph(&SFU_RTD(GraphINOUT));
 
-    //Enable slicer
-    i2c_slider = pi_l2_malloc(sizeof(pi_device_t));
-    init_ads1014(i2c_slider);
+    // runtime parameters: ADC slider polled in background, UART commands
+    i2c_slider = (pi_device_t *) l2_arena_get(L2_SLIDER);
+    if (control_slider_start(i2c_slider, CONTROL_SLIDER_US))
+    {
+        printf("Failed to open the slider ADC\n");
+        pmsis_exit(-1);
+    }
+#ifdef CONTROL_UART
+    if (control_uart_start(CONTROL_UART_ITF, CONTROL_UART_BAUDRATE))
+    {
+        printf("Failed to open the control UART\n");
+        pmsis_exit(-1);
+    }
+#endif
 
 #else //IS_SFU == 0 
 
@@ -554,14 +1029,9 @@ void denoiser(void)
     
 #if IS_INPUT_STFT == 0 
 
-    // Read Audio Data from file using __PREFIX(_L2_Memory) as temporary buffer
+    // Read Audio Data from file using the wav staging buffer of the L2 arena
     // Data are prepared in L3 external memory
- 
-    __PREFIX(_L2_Memory) = pi_l2_malloc(denoiser_L2_SIZE);
-    if (__PREFIX(_L2_Memory) == 0) {
-        printf("Error when allocating L2 buffer\n");
-        pmsis_exit(18);        
-    }
+    short *wav_buffer = (short *) l2_arena_get(L2_WAV_IN);
     
     // Allocate L3 buffers for audio IN/OUT
     if (pi_ram_alloc(&DefaultRam, &inSig, (uint32_t) AUDIO_BUFFER_SIZE*sizeof(short)))
@@ -579,7 +1049,7 @@ void denoiser(void)
     printf("Reading wav from: %s \n", WavName);
     header_struct header_info;
       if (ReadWavFromFile(WavName,
-            __PREFIX(_L2_Memory), AUDIO_BUFFER_SIZE*sizeof(short), &header_info)){
+            wav_buffer, denoiser_L2_SIZE, &header_info)){
         printf("\nError reading wav file\n");
         pmsis_exit(1);
     }
@@ -588,23 +1058,72 @@ void denoiser(void)
     printf("Finished Read wav.\n");
 
 
-    if(num_samples*sizeof(short) > denoiser_L2_SIZE){
+    // the processing runs at SAMPLING_FREQ: other rates are converted hop by hop and restored on output
+    int resample = (header_info.SampleRate != SAMPLING_FREQ);
+    int num_samples_proc = num_samples;
+    if (resample) {
+        num_samples_proc = (int) (((long long) num_samples * SAMPLING_FREQ) / header_info.SampleRate);
+        printf("Resampling from %d Hz to %d Hz (%d samples)\n", header_info.SampleRate, SAMPLING_FREQ, num_samples_proc);
+    }
+
+    if(num_samples*sizeof(short) > denoiser_L2_SIZE || num_samples_proc*sizeof(short) > denoiser_L2_SIZE){
         printf("The size of the audio exceeds the available L2 memory space!\n");
         pmsis_exit(1);
     }
 
     // copy input data to L3
-    pi_ram_write(&DefaultRam, inSig, __PREFIX(_L2_Memory), num_samples * sizeof(short));
+    pi_ram_write(&DefaultRam, inSig, wav_buffer, num_samples * sizeof(short));
+
+#ifdef METRICS_REF_WAV
+    // the clean reference is compared at SAMPLING_FREQ, aligned with the input
+    printf("Reading the clean reference from: %s \n", __XSTR(METRICS_REF_WAV));
+    header_struct ref_info;
+    if (ReadWavFromFile(__XSTR(METRICS_REF_WAV), wav_buffer, denoiser_L2_SIZE, &ref_info)){
+        printf("\nError reading the clean reference wav file\n");
+        pmsis_exit(1);
+    }
+    if (resample || ref_info.SampleRate != SAMPLING_FREQ) {
+        printf("The input and the clean reference must be sampled at %d Hz\n", SAMPLING_FREQ);
+        pmsis_exit(1);
+    }
+    Ref_Samples = ref_info.DataSize * 8 / (ref_info.NumChannels * ref_info.BitsPerSample);
+    if (Ref_Samples > num_samples) Ref_Samples = num_samples;
+    if (pi_ram_alloc(&DefaultRam, &refSig, (uint32_t) Ref_Samples*sizeof(short)))
+    {
+        printf("refSig Ram malloc failed !\n");
+        pmsis_exit(-4);
+    }
+    pi_ram_write(&DefaultRam, refSig, wav_buffer, Ref_Samples * sizeof(short));
+#endif
 
     // Reset Output Buffer and copy to L3
-    short * out_temp_buffer = (short *) __PREFIX(_L2_Memory);
-    for(int i=0; i < num_samples; i++){
+    short * out_temp_buffer = wav_buffer;
+    int num_samples_max = (num_samples_proc > num_samples) ? num_samples_proc : num_samples;
+    for(int i=0; i < num_samples_max; i++){
         out_temp_buffer[i] = 0;
     }
-    pi_ram_write(&DefaultRam, outSig,   __PREFIX(_L2_Memory), num_samples * sizeof(short));
+    pi_ram_write(&DefaultRam, outSig,   wav_buffer, num_samples_proc * sizeof(short));
+
+    if (resample) {
+        if (pi_ram_alloc(&DefaultRam, &outSigFs, (uint32_t) AUDIO_BUFFER_SIZE*sizeof(short)))
+        {
+            printf("outSigFs Ram malloc failed !\n");
+            pmsis_exit(-6);
+        }
+        pi_ram_write(&DefaultRam, outSigFs, wav_buffer, num_samples * sizeof(short));
 
-    // free the temporary input memory
-    pi_l2_free( __PREFIX(_L2_Memory), denoiser_L2_SIZE);
+        // the buffers of the resamplers are planned for the rate of WAV_FILE at build time
+        if (header_info.SampleRate != WAV_FS) {
+            printf("The wav file is sampled at %d Hz, the build at %d Hz: run make clean\n", header_info.SampleRate, WAV_FS);
+            pmsis_exit(-6);
+        }
+        if (resampler_init(&Rs_In, WAV_FS, SAMPLING_FREQ, RS_IN_MAX, l2_arena_get(L2_RS_IN_MEM)) ||
+            resampler_init(&Rs_Out, SAMPLING_FREQ, WAV_FS, RS_OUT_MAX, l2_arena_get(L2_RS_OUT_MEM)))
+        {
+            printf("Resampler allocation failed !\n");
+            pmsis_exit(-6);
+        }
+    }
 
 
 #endif //IS_INPUT_STFT == 0 
@@ -615,12 +1134,39 @@ void denoiser(void)
         Setup STFT/ISTF task
     ******/
     printf("Setup STFT task!\n");
+    // the scratch block of the arena (wav staging) is released for the graph
+    l2_arena_phase(L2_PHASE_RUN);
+    Audio_Frame = (DATATYPE_SIGNAL *) l2_arena_get(L2_AUDIO_FRAME);
+    Audio_Frame_temp = l2_arena_get(L2_AUDIO_TEMP);
+    STFT_Spectrogram = (DATATYPE_SIGNAL *) l2_arena_get(L2_SPECTROGRAM);
+    STFT_Magnitude = (DATATYPE_SIGNAL *) l2_arena_get(L2_MAGNITUDE);
+#if NUM_BANDS > 0
+    Band_Magnitude = (DATATYPE_SIGNAL *) l2_arena_get(L2_BANDS);
+#endif
+#ifndef MODEL_SET
+    RNN_STATE_0_I = (DATATYPE_SIGNAL_INF *) l2_arena_get(L2_RNN_STATE_0_I);
+    RNN_STATE_1_I = (DATATYPE_SIGNAL_INF *) l2_arena_get(L2_RNN_STATE_1_I);
+#ifndef GRU
+    RNN_STATE_0_C = (DATATYPE_SIGNAL_INF *) l2_arena_get(L2_RNN_STATE_0_C);
+    RNN_STATE_1_C = (DATATYPE_SIGNAL_INF *) l2_arena_get(L2_RNN_STATE_1_C);
+#endif
+#endif
+#if IS_SFU == 1
+    Previous_Mask = (DATATYPE_SIGNAL *) l2_arena_get(L2_PREVIOUS_MASK);
+#elif IS_INPUT_STFT == 0
+    Metrics_Ref = (short int *) l2_arena_get(L2_METRICS_REF);
+#ifdef METRICS_REF_WAV
+    Metrics_Clean = (short int *) l2_arena_get(L2_METRICS_CLEAN);
+#endif
+    Resampled_Frame = (short int *) l2_arena_get(L2_RS_FRAME);
+    Resampled_Out = (short int *) l2_arena_get(L2_RS_OUT);
+#else
+    Stft_Chunk[0] = (float *) l2_arena_get(L2_STFT_CHUNKS);
+    Stft_Chunk[1] = Stft_Chunk[0] + STFT_CHUNK_FRAMES*STFT_BINS*AT_INPUT_HEIGHT;
+#endif
     struct pi_cluster_task* task_stft;
-    task_stft = pi_l2_malloc(sizeof(struct pi_cluster_task));
+    task_stft = (struct pi_cluster_task *) l2_arena_get(L2_TASKS);
     pi_cluster_task(task_stft,&RunSTFT,NULL);
-    if (task_stft == NULL) {
-        PRINTF("failed to allocate memory for task\n");
-    }
     pi_cluster_task_stacks(task_stft, NULL, SLAVE_STACK_SIZE);
 
 
@@ -632,38 +1178,88 @@ void denoiser(void)
     ******/
     printf("Setup Cluster Task for inference!\n");
     struct pi_cluster_task* task_net;
-    task_net = pi_l2_malloc(sizeof(struct pi_cluster_task));
+    task_net = task_stft + 1;
     pi_cluster_task(task_net,&RunDenoiser,NULL);
-    if(task_net==NULL) {
-      PRINTF("pi_cluster_task alloc Error!\n");
-      pmsis_exit(-1);
-    }
     pi_cluster_task_stacks(task_net, NULL, SLAVE_STACK_SIZE);
     PRINTF("Stack size is %d and %d\n",STACK_SIZE,SLAVE_STACK_SIZE );
     
     // Reset LSTM
     ResetLSTM = 1;
+#ifndef MODEL_SET
     for(int i=0; i<RNN_STATE_DIM_0; i++){
         RNN_STATE_0_I[i] = (DATATYPE_SIGNAL_INF) 0.0f;
     }
     for(int i=0; i<RNN_STATE_DIM_1; i++){
         RNN_STATE_1_I[i] = (DATATYPE_SIGNAL_INF) 0.0f;
     }
+#endif
 
     /******
         Denoiser NN constructor
     ******/
     PRINTF("\n\nDenoiser Constructor\n");
+#ifdef MODEL_SET
+    // the main model first, the extra ones of MODEL_SET: ranked by cost at the construction
+    model_set_add(&__PREFIX(_Entry));
+#   ifdef MODEL_SET_denoiser_dns
+    model_set_add(&denoiser_dns_Entry);
+#   endif
+#   ifdef MODEL_SET_denoiser_GRU
+    model_set_add(&denoiser_GRU_Entry);
+#   endif
+#   ifdef MODEL_SET_denoiser
+    model_set_add(&denoiser_Entry);
+#   endif
+#   ifdef MODEL_SET_wiener
+    model_set_add(&wiener_Entry);
+#   endif
+    int err_construct = model_set_construct(&cluster_dev, NN_BUFFER);
+    model_set_cap(MODEL_CYCLES_CAP);
+#elif defined(WIENER)
+    // no graph to construct: the model is only linked for its L2 buffer, used by the file modes
+    int err_construct = 0;
+#else
     int err_construct = __PREFIX(CNN_Construct)();
+#endif
     if (err_construct)
     {
         PRINTF("Graph constructor exited with error: %d\n", err_construct);
         pmsis_exit(-5);
     }
     PRINTF("Denoiser Contrcuctor OK! The L1 memory base is: %x\n",__PREFIX(_L1_Memory));
+#ifdef MODEL_SET
+    model_set_print();
+#endif
+    Construct_Us = pi_time_get_us() - Start_Us;
 
 #endif // DISABLE_NN_INFERENCE
 
+#if defined(DISABLE_NN_INFERENCE) || defined(WIENER)
+    l2_arena_graph(0);
+#elif defined(MODEL_SET)
+    l2_arena_graph(model_set_l2_size());
+#else
+    l2_arena_graph(denoiser_L2_SIZE);
+#endif
+    l2_arena_print();
+
+
+    metrics_reset(&Metrics);
+
+#ifdef TRACE
+#if IS_SFU == 1
+    // no file system on board: the last events are kept in the L2 ring
+    int err_trace = trace_open(NULL, HOP_US);
+#elif IS_INPUT_STFT == 0
+    int err_trace = trace_open(__XSTR(TRACE_FILE), HOP_US);
+#else
+    int err_trace = trace_open(__XSTR(TRACE_FILE), 0);
+#endif
+    if (err_trace) {
+        printf("Failed to open the trace file %s\n", __XSTR(TRACE_FILE));
+        pmsis_exit(-7);
+    }
+#endif
 
 #if IS_INPUT_STFT == 0 
 
@@ -676,57 +1272,139 @@ void denoiser(void)
     
     // audio from file
 
-    int tot_frames = (int) (((float)num_samples / FRAME_STEP) - NUM_FRAME_OVERLAP) ;
+    int tot_frames = (int) (((float)num_samples_proc / FRAME_STEP) - NUM_FRAME_OVERLAP) ;
     printf("Number of frames to be processed: %d\n", tot_frames);
+#ifdef LATENCY_PROBE
+    probe_reset(SAMPLING_FREQ, LATENCY_PROBE_PERIOD, LATENCY_PROBE_PERIOD / 2, LATENCY_PROBE_AMP, LATENCY_BUFFER_HOPS * HOP_US);
+#endif
 
     for (int frame_id=0; frame_id < tot_frames; frame_id++)
     {   
-        printf("***** Processing Frame %d of %d ***** \n", frame_id+1, tot_frames);
+#ifdef LATENCY_PROBE
+        // the file stands in for the microphone: the frame is complete in real-time
+        probe_wait(frame_id * FRAME_STEP + FRAME_SIZE);
+#endif
+        unsigned int t_hop = pi_time_get_us();
+        TRACE_HOP_START(frame_id, Metrics.clipped);
+        PRINTF("***** Processing Frame %d of %d ***** \n", frame_id+1, tot_frames);
         // Copy Data from L3 to L2
+        TRACE_START(TRACE_INPUT);
         short * in_temp_buffer = (short *) Audio_Frame;
-        pi_ram_read(
-            &DefaultRam, 
-            inSig + frame_id * FRAME_STEP * sizeof(short), 
-            in_temp_buffer, 
-            (uint32_t) FRAME_SIZE*sizeof(short)
-        );
-        // cast data from Q16.15 to DATATYPE_SIGNAL (may be float16)
-        PRINTF("Audio In: ");
-        for (int i= 0 ; i<FRAME_SIZE; i++){
-            Audio_Frame[i] = ((DATATYPE_SIGNAL) in_temp_buffer[i] )/(1<<15);
-            PRINTF("%f, ", Audio_Frame[i] );
+        if (resample) {
+            // slide the frame and resample only the new hop (the whole frame at the first one)
+            int n_new = (frame_id == 0) ? FRAME_SIZE : FRAME_STEP;
+            for (int i = 0; i < FRAME_SIZE - n_new; i++) {
+                Resampled_Frame[i] = Resampled_Frame[i + n_new];
+            }
+            ResampleInput(&cluster_dev, inSig, num_samples, Resampled_Frame + FRAME_SIZE - n_new, n_new);
+            in_temp_buffer = Resampled_Frame;
+        } else {
+            pi_ram_read(
+                &DefaultRam, 
+                inSig + frame_id * FRAME_STEP * sizeof(short), 
+                in_temp_buffer, 
+                (uint32_t) FRAME_SIZE*sizeof(short)
+            );
+        }
+#ifdef LATENCY_PROBE
+        // impulses on the new samples (the whole frame is read again from L3 if not resampled)
+        int n_probe = (resample && frame_id > 0) ? FRAME_STEP : FRAME_SIZE;
+        probe_inject(in_temp_buffer + FRAME_SIZE - n_probe, frame_id * FRAME_STEP + FRAME_SIZE - n_probe, n_probe);
+#endif
+        for (int i= 0 ; i<FRAME_STEP; i++){
+            Metrics_Ref[i] = in_temp_buffer[i];
         }
+        TRACE_STOP(TRACE_INPUT);
+
+        // cast from Q16.15 to DATATYPE_SIGNAL (may be float16) by the STFT task
+        Input_Q15 = in_temp_buffer;
 #else   
 
     // audio from SFU
 
+    // the processing starts from the next chunk, the previous ones have been played in passthrough
     chunk_in_cnt=0;
-    SFU_StartGraph(&SFU_RTD(GraphINOUT));
+    chunk_ring_skip(&Chunk_Ring);
+    Passthrough = 0;
     while(1){
-        slider_value = ads1014_read(i2c_slider, 0);
-        pi_task_wait_on(&proc_task);
-
-#ifdef AUDIO_EVK
-        pi_gpio_pin_write(&gpio_port, gpio_pin_o, 1);
+        if (Codec_Ready == 1) {
+            //printf("Setup DAC OK\n"); 
+            dac_bringup_end();
+            Codec_Us = pi_time_get_us() - Start_Us;
+            Codec_Ready = 2;
+        }
+        // the callback pushes the task after publishing the chunk: no wake-up is missed
+        while (chunk_ring_empty(&Chunk_Ring)) {
+            pi_task_wait_on(&proc_task);
+            pi_task_block(&proc_task);
+        }
+        uint32_t seq, backlog;
+        uint32_t gap = chunk_ring_pop(&Chunk_Ring, &seq, &backlog);
+        unsigned int t_hop = pi_time_get_us();
+        TRACE_HOP_START(seq, Metrics.clipped);
+
+        // runtime parameters, the same for the whole hop
+        if (control_snapshot(&Params)) {
+            slider_value = Params.slider;
+            Out_Gain = Params.gain;
+#ifdef MODEL_SET
+            if (model_set_pin(Params.model[0] ? Params.model : NULL))
+                printf("Unknown model: %s\n", Params.model);
 #endif
-
-        int round = (chunk_in_cnt%CHUNK_NUM);
-        int round_out = (chunk_in_cnt>(STRUCT_DELAY-1))? ((chunk_in_cnt-(STRUCT_DELAY-1))%CHUNK_NUM):0;
-
-        //First Copy previous loop processed frame to output
-        for(int i=0;i<BUFF_SIZE/4;i++) {
-            ((int32_t*)BufferOutList[round_out])[i]= (int32_t)((float)(Audio_Frame_temp[i])*((int)(1<<Q_BIT_OUT)));
         }
 
-
-        for(int i=0;i<FRAME_SIZE-FRAME_STEP;i++){
-            Audio_Frame[i] = Audio_Frame[i+FRAME_STEP];
-            Audio_Frame_temp[i] = Audio_Frame_temp[i+FRAME_STEP];
+        // overrun policy
+        int drop_hop = chunk_ring_stale(&Chunk_Ring, seq);
+        Mask_Mode = MASK_NN;
+        if (drop_hop) {
+            TRACE_HOP_FLAG(TRACE_FLAG_LOST);
+        } else if (backlog >= SFU_BACKLOG) {
+            TRACE_HOP_FLAG(TRACE_FLAG_DEGRADED);
+#if SFU_OVERRUN == SFU_OVERRUN_DROP
+            drop_hop = 1;
+            Chunk_Ring.dropped++;
+#elif SFU_OVERRUN == SFU_OVERRUN_CONCEAL
+            Mask_Mode = MASK_PREVIOUS;
+            Chunk_Ring.concealed++;
+#else
+            Mask_Mode = MASK_NONE;
+            Chunk_Ring.bypassed++;
+#endif
+        }
+        if (Params.bypass) Mask_Mode = MASK_NONE;
+        if (gap > 0) {
+            // the chunks in between are missing: restart the overlap-and-add
+            TRACE_HOP_FLAG(TRACE_FLAG_LOST);
+            for (int i = 0; i < FRAME_SIZE; i++) {
+                Audio_Frame[i] = (DATATYPE_SIGNAL) 0.0f;
+                Audio_Frame_temp[i] = (DATATYPE_SIGNAL) 0.0f;
+            }
         }
 
-        for(int i=0;i<FRAME_STEP;i++){
-            Audio_Frame[i+FRAME_SIZE-FRAME_STEP] = (DATATYPE_SIGNAL)(((float)((int32_t*)BufferInList[round])[i]) /((int)(1<<Q_BIT_IN)));
-            Audio_Frame_temp[i+FRAME_SIZE-FRAME_STEP] = (DATATYPE_SIGNAL) 0.0f;
+#ifdef AUDIO_EVK
+        pi_gpio_pin_write(&gpio_port, gpio_pin_o, 1);
+#endif
+
+        TRACE_START(TRACE_INPUT);
+        int round = (seq%CHUNK_NUM);
+        int round_out = (seq>(STRUCT_DELAY-1))? ((seq-(STRUCT_DELAY-1))%CHUNK_NUM):0;
+
+        // previous loop processed frame to output, new hop to input: converted by SfuHopIO
+        Sfu_Out_Chunk = (int32_t *) BufferOutList[round_out];
+        Sfu_In_Chunk = (drop_hop) ? NULL : (int32_t *) BufferInList[round];
+        TRACE_STOP(TRACE_INPUT);
+
+        if (drop_hop) {
+            // the next hops play the tail of the overlap-and-add, faded by the windows
+            TRACE_START(TRACE_INPUT);
+            pi_cluster_task(task_stft, &SfuHopIO, NULL);
+            pi_cluster_send_task_to_cl(&cluster_dev, task_stft);
+            TRACE_STOP(TRACE_INPUT);
+            metrics_add_clipping(&Metrics, Io_Clipped);
+            t_hop = pi_time_get_us() - t_hop;
+            TRACE_HOP_STOP(t_hop, HOP_US, Metrics.clipped);
+            chunk_in_cnt++;
+            continue;
         }
 
 #endif //IS_SFU == 0     
@@ -745,20 +1423,26 @@ void denoiser(void)
             pmsis_exit(-1);
         }
 
+        TRACE_START(TRACE_STFT);
         pi_cluster_send_task_to_cl(&cluster_dev, task_stft);
+        TRACE_STOP(TRACE_STFT);
         pi_l1_free(&cluster_dev, L1_Memory,_L1_Memory_SIZE);
+#if IS_SFU == 1
+        // beyond the full scale of the output
+        metrics_add_clipping(&Metrics, Io_Clipped);
+#endif
 
         /***
             Check the Spectrogram Results
         ***/
         PRINTF("\nSTFT OUT: ");
-        for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT*2; i++ ){
+        for (int i = 0; i< STFT_BINS*AT_INPUT_HEIGHT*2; i++ ){
             PRINTF("%f, ",STFT_Spectrogram[i]);
         }
         PRINTF("\n");
 
         PRINTF("\nMagnitude OUT: ");
-        for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
+        for (int i = 0; i< STFT_BINS*AT_INPUT_HEIGHT; i++ ){
             PRINTF("%f, ",STFT_Magnitude[i]);
         }
         PRINTF("\n");
@@ -767,45 +1451,68 @@ void denoiser(void)
 #   else // IS_INPUT_STFT == 0  //load the STFT 
 
 
-    // open FS and read the binary files with STFT (flaot values)
+    // open FS and the packed STFT file (float32 or float16 frames)
     struct pi_hostfs_conf conf;
     pi_hostfs_conf_init(&conf);
     conf.fs.flash = &flash;
     pi_open_from_conf(&fs, &conf);
-    if (pi_fs_mount(&fs))
-        return -2;
+    if (pi_fs_mount(&fs)) {
+        printf("Error mounting the host FS\n");
+        pmsis_exit(-2);
+    }
 
-    for(int frame_id = 0; frame_id<STFT_FRAMES; frame_id++){
+    printf("STFT file being read is : %s\n", __XSTR(STFT_FILE));
+    file[0] = pi_fs_open(&fs, __XSTR(STFT_FILE), 0);
+    if (file[0] == 0) {
+        printf("Failed to open file, %s\n", __XSTR(STFT_FILE)); 
+        pmsis_exit(7);
+    }
 
-        PRINTF("Reading STFT file %.4d/%d...\n", frame_id, STFT_FRAMES );
-        sprintf(WavName, "../../../samples/mags_%.4d.bin",frame_id);
-        printf("File being read is : %s\n", WavName);
+    stft_pack_header_t stft_header;
+    int len = pi_fs_read(file[0], &stft_header, sizeof(stft_pack_header_t));
+    if (len != sizeof(stft_pack_header_t) || stft_header.magic != STFT_PACK_MAGIC || stft_header.version != STFT_PACK_VERSION){
+        printf("Not a packed STFT file (see test_accuracy/pack_stft.py)\n"); 
+        pmsis_exit(8);
+    }
+    if (stft_header.num_bins != STFT_BINS*AT_INPUT_HEIGHT || stft_header.num_frames < STFT_FRAMES){
+        printf("The STFT file has %d frames of %d bins, expected %d frames of %d bins\n",
+            stft_header.num_frames, stft_header.num_bins, STFT_FRAMES, STFT_BINS*AT_INPUT_HEIGHT); 
+        pmsis_exit(8);
+    }
+    int frame_bytes = stft_pack_frame_bytes(&stft_header);
+    if (frame_bytes == 0) {
+        printf("Unknown STFT dtype %d (see stft_pack.h)\n", stft_header.dtype);
+        pmsis_exit(8);
+    }
+    printf("Reading %d frames (%s)\n", STFT_FRAMES, (stft_header.dtype == STFT_PACK_FLOAT16) ? "float16" : "float32");
 
-        file[0] = pi_fs_open(&fs, WavName, 0);
+    // the frames are sequential in the file: the first chunk is requested here,
+    // the next one while the current chunk is processed
+    pi_task_t stft_read_task;
+    int chunk_frames = (STFT_FRAMES < STFT_CHUNK_FRAMES) ? STFT_FRAMES : STFT_CHUNK_FRAMES;
+    pi_fs_read_async(file[0], (char *) Stft_Chunk[0], chunk_frames * frame_bytes, pi_task_block(&stft_read_task));
 
-        if (file[0] == 0) {
-            printf("Failed to open file, %s\n", WavName); 
-            pmsis_exit(7);
-        }
-        printf("File %x of size %d\n", file[0], sizeof(pi_fs_file_t));
-
-        int TotBytes = sizeof(float)*AT_INPUT_WIDTH*AT_INPUT_HEIGHT;
-        int len = pi_fs_read(file[0], STFT_Spectrogram, TotBytes);
-        printf("Bytes read %d - of %d bytes expected\n", len,TotBytes );
-        if (len != TotBytes){
-            printf("Too few bytes in %s\n", WavName); 
-            pmsis_exit(8);
-        } 
-        //__CLOSE(File);
-        pi_fs_close(file[0]);
-
-        float * spectrogram_fp32 = (float *)STFT_Spectrogram;
-        for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
-            PRINTF("%f ",spectrogram_fp32[i]);
-            STFT_Magnitude[i] = (DATATYPE_SIGNAL) spectrogram_fp32[i] ;
-            PRINTF(" - %f), ",STFT_Magnitude[i]);
+    for(int frame_id = 0; frame_id<STFT_FRAMES; frame_id++){
 
+        TRACE_HOP_START(frame_id, Metrics.clipped);
+        TRACE_START(TRACE_INPUT);
+        int chunk = frame_id / STFT_CHUNK_FRAMES;
+        int slot = frame_id % STFT_CHUNK_FRAMES;
+        if (slot == 0) {
+            pi_task_wait_on(&stft_read_task);
+            int next_frames = STFT_FRAMES - (chunk + 1) * STFT_CHUNK_FRAMES;
+            if (next_frames > 0) {
+                if (next_frames > STFT_CHUNK_FRAMES) next_frames = STFT_CHUNK_FRAMES;
+                pi_fs_read_async(file[0], (char *) Stft_Chunk[(chunk + 1) & 1], next_frames * frame_bytes, pi_task_block(&stft_read_task));
+            }
         }
+        char *stft_frame = (char *) Stft_Chunk[chunk & 1] + slot * frame_bytes;
+        PRINTF("Reading STFT frame %.4d/%d...\n", frame_id, STFT_FRAMES );
+
+        // converted to STFT_Magnitude by the NN task
+        Stft_Frame = stft_frame;
+        Stft_Frame_Dtype = stft_header.dtype;
+        TRACE_STOP(TRACE_INPUT);
 
 #   endif // load data STFT or AUDIO
 
@@ -820,23 +1527,37 @@ void denoiser(void)
         // Debug PRINT
         PRINTF("\n Denoiser Input\n");
         for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
-            PRINTF("%f, ",STFT_Magnitude[i]);
+            PRINTF("%f, ",NN_BUFFER[i]);
         }
 
         PRINTF("Send task to cluster\n");
+#ifdef MODEL_SET
+        unsigned int t_nn = pi_time_get_us();
+#endif
+        TRACE_START(TRACE_NN);
    	    pi_cluster_send_task_to_cl(&cluster_dev, task_net);
+        TRACE_STOP(TRACE_NN);
+#ifdef MODEL_SET
+        t_nn = pi_time_get_us() - t_nn;
+#endif
+#ifdef METRICS
+#if IS_SFU == 1
+        if (Mask_Mode == MASK_NN)
+#endif
+        metrics_update_mask(&Metrics, NN_BUFFER, AT_INPUT_WIDTH*AT_INPUT_HEIGHT);
+#endif
 
         // Debug PRINT
         PRINTF("\n Denoiser Output\n");
         for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
-            PRINTF("%f, ",STFT_Magnitude[i]);
+            PRINTF("%f, ",NN_BUFFER[i]);
         }
         PRINTF("\nSTFT Filtered: ");
-        for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT*2; i++ ){
+        for (int i = 0; i< STFT_BINS*AT_INPUT_HEIGHT*2; i++ ){
             PRINTF("%f, ", STFT_Spectrogram[i]);
         }
 
-    #ifdef PERF
+    #if defined(PERF) && !defined(MODEL_SET) && !defined(WIENER)
         {
             unsigned int TotalCycles = 0, TotalOper = 0;
             PRINTF("\n");
@@ -845,6 +1566,7 @@ void denoiser(void)
                     AT_GraphNodeNames[i], AT_GraphPerf[i], AT_GraphOperInfosNames[i], 
                     ((float) AT_GraphOperInfosNames[i])/ AT_GraphPerf[i]);
                 TotalCycles += AT_GraphPerf[i]; TotalOper += AT_GraphOperInfosNames[i];
+                AT_GraphPerf_Acc[i] += AT_GraphPerf[i];
             }
             PRINTF("\n");
             PRINTF("%45s: Cycles: %10d, Operations: %10d, Operations/Cycle: %f\n", "Total", TotalCycles, TotalOper, ((float) TotalOper)/ TotalCycles);
@@ -859,10 +1581,10 @@ void denoiser(void)
         if(frame_id == STFT_FRAMES-1){ // last frame
             p_err = 0.0f; p_sig=0.0f;
             for (int i = 0; i< AT_INPUT_WIDTH*AT_INPUT_HEIGHT; i++ ){
-                float err = ((float) STFT_Magnitude[i]) - Denoiser_Golden[i]; 
+                float err = ((float) NN_BUFFER[i]) - Denoiser_Golden[i]; 
                 p_err += err * err;
-                p_sig += STFT_Magnitude[i] * STFT_Magnitude[i];
-                PRINTF("[%d] %f vs %f -> %f\n", i, STFT_Magnitude[i], Denoiser_Golden[i], (err * err)/(STFT_Magnitude[i] * STFT_Magnitude[i]));
+                p_sig += NN_BUFFER[i] * NN_BUFFER[i];
+                PRINTF("[%d] %f vs %f -> %f\n", i, NN_BUFFER[i], Denoiser_Golden[i], (err * err)/(NN_BUFFER[i] * NN_BUFFER[i]));
             }
             snr = p_sig / p_err;
             printf("Denoiser Signal-to-noise ratio in linear scale: %f\n", snr);
@@ -894,6 +1616,13 @@ void denoiser(void)
             ISTF Task
         ******/
         PRINTF("\n\n****** Computing iSTFT ***** \n");
+#if IS_SFU == 0
+        // previous output frame, the overlap-and-add is completed by the iSTFT task
+        TRACE_START(TRACE_OUTPUT);
+        pi_ram_read(&DefaultRam,  (short *) outSig + (frame_id*FRAME_STEP), 
+            Audio_Frame_temp, FRAME_SIZE * sizeof(short));
+        TRACE_STOP(TRACE_OUTPUT);
+#endif
         pi_cluster_task(task_stft, &RuniSTFT, NULL);
         L1_Memory = pi_l1_malloc(&cluster_dev, _L1_Memory_SIZE);
         if (L1_Memory==NULL){
@@ -901,7 +1630,9 @@ void denoiser(void)
             pmsis_exit(-1);
         }
 
+        TRACE_START(TRACE_ISTFT);
         pi_cluster_send_task_to_cl(&cluster_dev, task_stft);
+        TRACE_STOP(TRACE_ISTFT);
 
     	pi_l1_free(&cluster_dev, L1_Memory,_L1_Memory_SIZE);
 
@@ -909,24 +1640,12 @@ void denoiser(void)
         // debug printf
         PRINTF("\nAudio Out: ");
         for (int i= 0 ; i<FRAME_SIZE; i++){
-            PRINTF("%f,", Audio_Frame[i] );
-        }
-
-
-        //copy spectrogram into Audio Frames 
-        for (int i= 0 ; i<FRAME_SIZE; i++){
-#if IS_SFU == 1
-            // overlap and add using temporary buffer
-            // use Audio_Frame to store an output frame
-            //Audio_Frame_temp[i] = DRY * (STFT_Spectrogram[i] / 2 ) + (1-DRY)* Audio_Frame[i];   // FIXME: divide by 2 because of current Hanning windowing
-            Audio_Frame_temp[i] += (STFT_Spectrogram[i] / 2 );   // FIXME: divide by 2 because of current Hanning windowing
-#else
-            // use Audio_Frame to store an output frame
-            Audio_Frame[i] = (STFT_Spectrogram[i] / 2 );   // FIXME: divide by 2 because of current Hanning windowing
-#endif
+            PRINTF("%f,", STFT_Spectrogram[i] );
         }
         PRINTF("\n");
 
+        TRACE_START(TRACE_OUTPUT);
+
 
 
 #if IS_SFU == 1
@@ -935,8 +1654,37 @@ void denoiser(void)
 #ifdef AUDIO_EVK
         pi_gpio_pin_write(&gpio_port, gpio_pin_o, 0);
 #endif
+        TRACE_STOP(TRACE_OUTPUT);
+        if (First_Hop_Us == 0 && Mask_Mode == MASK_NN) First_Hop_Us = pi_time_get_us() - Start_Us;
+        t_hop = pi_time_get_us() - t_hop;
+        TRACE_HOP_STOP(t_hop, HOP_US, Metrics.clipped);
+        if (t_hop > Proc_Us_Max) Proc_Us_Max = t_hop;
+#ifdef DVFS
+        dvfs_update(t_hop, HOP_US);
+#endif
+#ifdef MODEL_SET
+        // the NN gets what the rest of the hop leaves of the budget
+        if (Mask_Mode == MASK_NN) model_set_update(t_nn, ModelBudget(t_hop - t_nn));
+#endif
+        if (Codec_Ready == 2 && First_Hop_Us > 0) {
+            PrintStartup();
+            Codec_Ready = 3;
+        }
+        if ((chunk_in_cnt % LATENCY_REPORT_HOPS) == 0) {
+            PrintLatency();
+            chunk_ring_print(&Chunk_Ring);
+#ifdef DVFS
+            dvfs_print_residency();
+#endif
+#ifdef MODEL_SET
+            model_set_print();
+#endif
+        }
+#if METRICS_REPORT_HOPS > 0
+        if (((chunk_in_cnt + 1) % METRICS_REPORT_HOPS) == 0) metrics_print(&Metrics);
+#endif
+
         chunk_in_cnt++;
-        pi_task_block(&proc_task);
 
 
 #else // audio from file 
@@ -944,26 +1692,133 @@ void denoiser(void)
         // if denoising auio files, outputs are loaded to the L3 output buffer outSig
         PRINTF("Writing Frame %d/%d to the output buffer\n\n", frame_id+1, tot_frames);
 
-        // Cast if needed
-        pi_ram_read(&DefaultRam,  (short *) outSig + (frame_id*FRAME_STEP), 
+        // saturated to the Q15 range by the iSTFT task
+        metrics_add_clipping(&Metrics, Io_Clipped);
+        pi_ram_write(&DefaultRam,  (short *) outSig + (frame_id*FRAME_STEP),   
             Audio_Frame_temp, FRAME_SIZE * sizeof(short));
 
-        // from DATA_S
-        for (int i= 0 ; i<FRAME_SIZE; i++){
-            Audio_Frame_temp[i] += (short int)(Audio_Frame[i] * (1<<15));
+        // the first hop of the output is complete
+        metrics_update_signal(&Metrics.input, Metrics_Ref, Audio_Frame_temp, FRAME_STEP);
+#ifdef METRICS_REF_WAV
+        if ((frame_id + 1) * FRAME_STEP <= Ref_Samples) {
+            pi_ram_read(&DefaultRam, refSig + frame_id * FRAME_STEP * sizeof(short),
+                Metrics_Clean, FRAME_STEP * sizeof(short));
+            metrics_update_signal(&Metrics.clean, Metrics_Clean, Audio_Frame_temp, FRAME_STEP);
         }
-        pi_ram_write(&DefaultRam,  (short *) outSig + (frame_id*FRAME_STEP),   
-            Audio_Frame_temp, FRAME_SIZE * sizeof(short));
+#endif
+#ifdef LATENCY_PROBE
+        probe_detect(Audio_Frame_temp, frame_id * FRAME_STEP, FRAME_STEP, frame_id * FRAME_STEP + FRAME_SIZE);
+#endif
+#if METRICS_REPORT_HOPS > 0
+        if (((frame_id + 1) % METRICS_REPORT_HOPS) == 0) metrics_print(&Metrics);
+#endif
+
+        // the first hop of the frame is complete: convert it back to the rate of the wav file
+        if (resample) {
+            ResampleOutput(&cluster_dev, outSigFs, num_samples, Audio_Frame_temp, FRAME_STEP);
+        }
+        TRACE_STOP(TRACE_OUTPUT);
+        if (First_Hop_Us == 0) First_Hop_Us = pi_time_get_us() - Start_Us;
+
+        t_hop = pi_time_get_us() - t_hop;
+        TRACE_HOP_STOP(t_hop, HOP_US, Metrics.clipped);
+        if (t_hop > Proc_Us_Max) Proc_Us_Max = t_hop;
+#ifdef DVFS
+        dvfs_update(t_hop, HOP_US);
+#endif
+#ifdef MODEL_SET
+        model_set_update(t_nn, ModelBudget(t_hop - t_nn));
+#endif
 #endif //IS_SFU == 1
 
+#else
+        if (First_Hop_Us == 0) First_Hop_Us = pi_time_get_us() - Start_Us;
+        TRACE_HOP_STOP(0, 0, Metrics.clipped);
 #endif //IS_INPUT_STFT == 0
 
+#ifdef PERF
+        Perf_Frames++;
+#endif
    }   // stop looping over frames
 
+#ifdef TRACE
+    trace_close();
+#endif
+
+#if IS_INPUT_STFT == 1
+    pi_fs_close(file[0]);
+    pi_fs_unmount(&fs);
+#endif
+
+
+#ifdef PERF
+    /*
+        Average cycles per hop over the whole run: used to compare the graph
+        settings (e.g. GRAPH_ASYNC_FORK, GRAPH_GROUP_WEIGHTS) node by node
+    */
+    if (Perf_Frames > 0) {
+        printf("\nAverage cycles per frame over %d frames:\n", Perf_Frames);
+#if IS_INPUT_STFT == 0
+        printf("%45s: Cycles: %10d\n", "STFT", (unsigned int) (STFT_Cycles_Acc / Perf_Frames));
+        printf("%45s: Cycles: %10d\n", "iSTFT", (unsigned int) (iSTFT_Cycles_Acc / Perf_Frames));
+#endif
+#ifdef WIENER
+        printf("%45s: Cycles: %10d\n", "Wiener", (unsigned int) (Wiener_Cycles_Acc / Perf_Frames));
+#elif !defined(DISABLE_NN_INFERENCE) && !defined(MODEL_SET)
+        uint64_t TotalCycles = 0;
+        for (int i=0; i<(sizeof(AT_GraphPerf)/sizeof(unsigned int)); i++) {
+            printf("%45s: Cycles: %10d\n", AT_GraphNodeNames[i], (unsigned int) (AT_GraphPerf_Acc[i] / Perf_Frames));
+            TotalCycles += AT_GraphPerf_Acc[i];
+        }
+        printf("%45s: Cycles: %10d\n", "Total NN", (unsigned int) (TotalCycles / Perf_Frames));
+#endif
+    }
+#endif  /* PERF */
+
+#if IS_INPUT_STFT == 0
+#ifdef LATENCY_BUDGET_US
+    unsigned int algo_us = PrintLatency();
+#else
+    PrintLatency();
+#endif
+#ifdef LATENCY_PROBE
+    if (probe_print() == 0) {
+        printf("Error: no impulse of the latency probe found at the output\n");
+        pmsis_exit(-10);
+    }
+    // worst case measured in the loop, with the output buffering of the SFU mode and the wav resamplers
+    unsigned int meas_us = probe_max_us() + LATENCY_SFU_OUT_HOPS * HOP_US + IoLatencyUs();
+    printf("Latency probe: worst case with the SFU output hop and the resamplers %d us\n", meas_us);
+#endif
+#ifdef LATENCY_BUDGET_US
+#ifdef LATENCY_PROBE
+    if (meas_us > LATENCY_BUDGET_US) {
+        printf("Error: measured latency %d us over the budget of %d us\n", meas_us, LATENCY_BUDGET_US);
+        pmsis_exit(-9);
+    }
+#endif
+    if (algo_us > LATENCY_BUDGET_US) {
+        printf("Error: algorithmic latency %d us over the budget of %d us\n", algo_us, LATENCY_BUDGET_US);
+        pmsis_exit(-9);
+    }
+#endif
+#endif // IS_INPUT_STFT == 0
+    PrintStartup();
+    metrics_print(&Metrics);
+#ifdef DVFS
+    dvfs_print_residency();
+#endif
+#ifdef MODEL_SET
+    model_set_print();
+#endif
 
 #ifndef DISABLE_NN_INFERENCE
+#if defined(MODEL_SET)
+    model_set_destruct(&cluster_dev);
+#elif !defined(WIENER)
     __PREFIX(CNN_Destruct)();
 #endif
+#endif
 
 
 
@@ -973,48 +1828,41 @@ void denoiser(void)
 */
 #if IS_INPUT_STFT == 0 && IS_SFU == 0
 
-    // allocate L2 Memory
-    __PREFIX(_L2_Memory) = pi_l2_malloc(denoiser_L2_SIZE);
-    if (__PREFIX(_L2_Memory) == 0) {
-        printf("Error when allocating L2 buffer\n");
-        pmsis_exit(18);        
+    if (resample) {
+        // flush the tail of the last frame and the delay of the filter
+        pi_ram_read(&DefaultRam, (short *) outSig + (tot_frames*FRAME_STEP),
+            Resampled_Frame, (FRAME_SIZE - FRAME_STEP) * sizeof(short));
+        ResampleOutput(&cluster_dev, outSigFs, num_samples, Resampled_Frame, FRAME_SIZE - FRAME_STEP);
+        ResampleOutput(&cluster_dev, outSigFs, num_samples, NULL, Rs_Out.taps);
+        outSig = outSigFs;
     }
 
-
-    // copy input data to L3
-    out_temp_buffer = (short int * ) __PREFIX(_L2_Memory); 
-    pi_ram_read(&DefaultRam, outSig,   out_temp_buffer, num_samples * sizeof(short));
-    
 #ifdef CHECKSUM
 
-    short int * in_temp_buffer = ((short int * ) __PREFIX(_L2_Memory)) + num_samples;
-    pi_ram_read(&DefaultRam, inSig,   in_temp_buffer, num_samples * sizeof(short));
-
-    p_err = 0.0f; p_sig=0.0f;
-    for (int i = 0; i< num_samples; i++ ){   // remove first and last elements from checksum
-        float in_signal = ((float) in_temp_buffer[i] )/(1<<15);
-        float out_signal = ((float) out_temp_buffer[i] )/(1<<15);
-        PRINTF("%f vs %f\n", in_signal, out_signal);
-        float err = in_signal - out_signal; 
-        p_err += (err * err);
-        p_sig += (in_signal * in_signal);
-
-    }
-    printf("Completed the checksum check over %d samples\n", num_samples);
-    if (p_err == 0.0)
-        snr = 1000000.0f;
-    else
-        snr = p_sig / p_err;
+    // the STFT+iSTFT checksum uses the SNR accumulated hop by hop at SAMPLING_FREQ:
+    // the band above SAMPLING_FREQ/2 of a resampled wav file is not restored
+    snr = metrics_snr(&Metrics.input);
+    printf("Completed the checksum check over %d hops\n", Metrics.input.hops);
     printf("ISTFT Signal-to-noise ratio in linear scale: %f\n", snr);
-    if (snr > 1000.0f)     // qsnr > 30db
+    if (snr > ISTFT_SNR_THR)
         printf("--> STFT+iSTFT OK!\n");
     else{
         printf("--> STFT+iSTFT NOK!\n");
         pmsis_exit(-1);
     }
 
-
 #else //CHECKSUM
+
+    // the wav staging buffer in the scratch block of the arena, after the graph destructor
+    if (l2_arena_phase(L2_PHASE_FLUSH)) {
+        printf("Error when allocating L2 buffer\n");
+        pmsis_exit(18);        
+    }
+
+    // copy output data from L3
+    out_temp_buffer = (short int * ) l2_arena_get(L2_WAV_OUT); 
+    pi_ram_read(&DefaultRam, outSig,   out_temp_buffer, num_samples * sizeof(short));
+
     // final sample
     PRINTF("\nAudio Out: ");
     for (int i= 0 ; i<num_samples; i++){
@@ -1022,15 +1870,16 @@ void denoiser(void)
     }
     PRINTF("\n");
 
-    WriteWavToFile("../../../test_gap.wav", 16, 16000, 1, 
-        (uint32_t *) __PREFIX(_L2_Memory), num_samples* sizeof(short));
+    WriteWavToFile("../../../test_gap.wav", 16, header_info.SampleRate, 1, 
+        (uint32_t *) out_temp_buffer, num_samples* sizeof(short));
     printf("Writing wav file to test_gap.wav completed successfully\n");
-#endif //CHECKSUM
 
-    pi_l2_free(__PREFIX(_L2_Memory),denoiser_L2_SIZE);
+#endif //CHECKSUM
 #endif //IS_INPUT_STFT == 0 && IS_SFU == 0
 
 
+    l2_arena_close();
+
     // Close the cluster
     pi_cluster_close(&cluster_dev);
     PRINTF("Ended\n");
@@ -1043,8 +1892,6 @@ int main()
 	PRINTF("\n\n\t *** Denoiser ***\n\n");
 
 #   if IS_SFU == 0 
-    #define __XSTR(__s) __STR(__s)
-    #define __STR(__s) #__s
     WavName = __XSTR(WAV_FILE);
 #   endif    
 
@@ -16,6 +16,7 @@
 #include "denoiser_GRUInfo.h"
 #define denoiser_L1_SIZE _denoiser_GRU_L1_Memory_SIZE
 #define denoiser_L2_SIZE _denoiser_GRU_L2_Memory_SIZE
+#define denoiser_L2_DYN_SIZE _denoiser_GRU_L2_Memory_Dyn_SIZE
 
 #define SCALE_IN denoiser_GRU_Input_1_OUT_SCALE
 #define SCALE_OUT denoiser_GRU_Output_1_OUT_SCALE
@@ -0,0 +1,3 @@
+// entry of the GRU model trained on Valentini in the model set (MODEL_SET)
+#include "denoiser_GRU.h"
+#include "model_entry.h"
@@ -16,6 +16,7 @@
 #include "denoiser_dnsInfo.h"
 #define denoiser_L1_SIZE _denoiser_dns_L1_Memory_SIZE
 #define denoiser_L2_SIZE _denoiser_dns_L2_Memory_SIZE
+#define denoiser_L2_DYN_SIZE _denoiser_dns_L2_Memory_Dyn_SIZE
 
 
 #define SCALE_IN denoiser_dns_Input_1_OUT_SCALE
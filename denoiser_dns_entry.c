@@ -0,0 +1,3 @@
+// entry of the GRU model trained on DNS (demo) in the model set (MODEL_SET)
+#include "denoiser_dns.h"
+#include "model_entry.h"
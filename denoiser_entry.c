@@ -0,0 +1,4 @@
+// entry of the LSTM model trained on Valentini in the model set (MODEL_SET)
+#include "denoiser.h"
+#define MODEL_ENTRY_LSTM
+#include "model_entry.h"
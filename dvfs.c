@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 GreenWaves Technologies
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ *
+ */
+
+#include "dvfs.h"
+
+#include "pmsis.h"
+
+// load (percentage of the hop deadline) above which the frequency is raised
+#ifndef DVFS_UP_THRESHOLD
+#define DVFS_UP_THRESHOLD   (85)
+#endif
+// the frequency is lowered only if the load at the lower point would stay below this threshold
+#ifndef DVFS_DOWN_THRESHOLD
+#define DVFS_DOWN_THRESHOLD (70)
+#endif
+// consecutive hops below the down threshold before stepping down
+#ifndef DVFS_DOWN_HOPS
+#define DVFS_DOWN_HOPS      (64)
+#endif
+
+// max frequency (MHz) sustained at 0.65V, higher frequencies require 0.8V
+#define DVFS_LV_MAX_FREQ    (240)
+
+static const dvfs_op_t dvfs_table[] = {
+    {  50, 650 },
+    { 100, 650 },
+    { 150, 650 },
+    { 200, 650 },
+    { 240, 650 },
+    { 300, 800 },
+    { 370, 800 },
+};
+#define DVFS_NUM_OP (sizeof(dvfs_table)/sizeof(dvfs_op_t))
+
+static int cur_op;
+static int below_cnt;
+static uint32_t min_voltage;
+static uint32_t switch_cnt;
+static uint32_t residency[DVFS_NUM_OP];
+
+static uint32_t op_voltage(int op)
+{
+    uint32_t voltage = dvfs_table[op].voltage;
+    return (voltage < min_voltage) ? min_voltage : voltage;
+}
+
+static void set_op(int op)
+{
+    if (op == cur_op) return;
+
+    // raise the voltage before the frequency, lower it after
+#ifdef AUDIO_EVK
+    if (op_voltage(op) > op_voltage(cur_op))
+        pi_pmu_voltage_set(PI_PMU_VOLTAGE_DOMAIN_CHIP, op_voltage(op));
+#endif
+    pi_freq_set(PI_FREQ_DOMAIN_CL, dvfs_table[op].freq_cl*1000*1000);
+#ifdef AUDIO_EVK
+    if (op_voltage(op) < op_voltage(cur_op))
+        pi_pmu_voltage_set(PI_PMU_VOLTAGE_DOMAIN_CHIP, op_voltage(op));
+#endif
+
+    cur_op = op;
+    below_cnt = 0;
+    switch_cnt++;
+}
+
+void dvfs_init(uint32_t freq_cl)
+{
+    // the chip voltage is shared with the fabric controller
+    min_voltage = (FREQ_FC > DVFS_LV_MAX_FREQ) ? 800 : 650;
+
+    int op = DVFS_NUM_OP - 1;
+    for (int i = DVFS_NUM_OP - 1; i >= 0; i--)
+    {
+        if (dvfs_table[i].freq_cl >= freq_cl) op = i;
+    }
+
+    cur_op = op;
+#ifdef AUDIO_EVK
+    pi_pmu_voltage_set(PI_PMU_VOLTAGE_DOMAIN_CHIP, op_voltage(op));
+#endif
+    pi_freq_set(PI_FREQ_DOMAIN_CL, dvfs_table[op].freq_cl*1000*1000);
+
+    below_cnt = 0;
+    switch_cnt = 0;
+    for (int i = 0; i < DVFS_NUM_OP; i++) residency[i] = 0;
+}
+
+void dvfs_update(uint32_t proc_us, uint32_t deadline_us)
+{
+    residency[cur_op]++;
+
+    uint32_t load = (proc_us * 100) / deadline_us;
+
+    if (load > DVFS_UP_THRESHOLD)
+    {
+        if (cur_op < DVFS_NUM_OP - 1) set_op(cur_op + 1);
+        return;
+    }
+
+    if (cur_op == 0) return;
+
+    // processing time expected at the lower operating point
+    uint32_t load_down = (load * dvfs_table[cur_op].freq_cl) / dvfs_table[cur_op - 1].freq_cl;
+    if (load_down < DVFS_DOWN_THRESHOLD)
+    {
+        if (++below_cnt >= DVFS_DOWN_HOPS) set_op(cur_op - 1);
+    }
+    else
+    {
+        below_cnt = 0;
+    }
+}
+
+void dvfs_print_residency(void)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < DVFS_NUM_OP; i++) total += residency[i];
+    if (total == 0) return;
+
+    printf("DVFS residency over %d hops (%d switches):\n", total, switch_cnt);
+    for (int i = 0; i < DVFS_NUM_OP; i++)
+    {
+        printf("\t%3d MHz @ %d mV: %8d hops (%3d%%)\n", dvfs_table[i].freq_cl, op_voltage(i),
+            residency[i], (residency[i] * 100) / total);
+    }
+}
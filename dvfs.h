@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2022 GreenWaves Technologies
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ *
+ */
+
+#pragma once
+#include <stdint.h>
+
+
+/*
+ * DVFS governor
+ *
+ * It reacts to the hop load by changing the cluster frequency, while the cost
+ * governor of the MODEL_SET (model_set.c) reacts to the same load by changing
+ * the model: running both, a single overload would step up the frequency and
+ * step down the model, and each one would then measure a load changed by the
+ * other. So the two are mutually exclusive at build time (Makefile).
+ */
+
+/*
+ * \brief cluster operating point: frequency (MHz) and chip voltage (mV)
+ */
+typedef struct {
+    uint32_t freq_cl;
+    uint32_t voltage;
+} dvfs_op_t;
+
+/*
+ * \brief select the initial operating point, the lowest one running at least at freq_cl MHz
+ */
+void dvfs_init(uint32_t freq_cl);
+
+/*
+ * \brief update the governor with the processing time of the last hop
+ *
+ * Steps up as soon as the load exceeds the upper threshold, steps down only
+ * after DVFS_DOWN_HOPS consecutive hops whose load would still fit the next
+ * lower operating point.
+ */
+void dvfs_update(uint32_t proc_us, uint32_t deadline_us);
+
+/*
+ * \brief print the number of hops spent at each operating point
+ */
+void dvfs_print_residency(void);
@@ -0,0 +1,147 @@
+#include "l2_arena.h"
+#include "pmsis.h"
+
+
+static l2_buffer_t *arena_plan;
+static int arena_num;
+static int arena_phase;
+static char *block[2];          // persistent, scratch
+static uint32_t block_size[2];
+static uint32_t graph_size;
+
+
+static inline uint32_t align_up(uint32_t size)
+{
+    return (size + L2_ARENA_ALIGN - 1) & ~(L2_ARENA_ALIGN - 1);
+}
+
+// the buffers live in the processing loop are in the persistent block, the others in the scratch one
+static inline int block_of(l2_buffer_t *b)
+{
+    return (b->phases & L2_PHASE_RUN) ? 0 : 1;
+}
+
+static inline int overlap(l2_buffer_t *a, l2_buffer_t *b)
+{
+    return (a->phases & b->phases) && (a->offset < b->offset + b->size) && (b->offset < a->offset + a->size);
+}
+
+// lowest offset of plan[i] not overlapping the buffers already placed in its block
+static uint32_t first_fit(int i, const char *done)
+{
+    l2_buffer_t *b = &arena_plan[i];
+    uint32_t best = 0xFFFFFFFF;
+    for (int c = -1; c < arena_num; c++)
+    {
+        // candidates: the bottom of the block and the end of every buffer placed
+        if (c >= 0 && !done[c]) continue;
+        b->offset = (c < 0) ? 0 : arena_plan[c].offset + arena_plan[c].size;
+        if (b->offset >= best) continue;
+        int fits = 1;
+        for (int j = 0; j < arena_num && fits; j++)
+        {
+            if (done[j] && overlap(b, &arena_plan[j])) fits = 0;
+        }
+        if (fits) best = b->offset;
+    }
+    return best;
+}
+
+static int alloc_block(int k)
+{
+    if (block_size[k] == 0) return 0;
+    block[k] = (char *) pi_l2_malloc(block_size[k]);
+    return (block[k] == NULL) ? -1 : 0;
+}
+
+static void free_block(int k)
+{
+    if (block[k] != NULL) pi_l2_free(block[k], block_size[k]);
+    block[k] = NULL;
+}
+
+int l2_arena_open(l2_buffer_t *plan, int n)
+{
+    arena_plan = plan;
+    arena_num = n;
+    for (int k = 0; k < 2; k++)
+    {
+        // the largest buffers first, each at the lowest offset free during its lifetime
+        char done[n];
+        for (int i = 0; i < n; i++) done[i] = 0;
+        block_size[k] = 0;
+        for (;;)
+        {
+            int i = -1;
+            for (int j = 0; j < n; j++)
+            {
+                if (!done[j] && block_of(&plan[j]) == k && (i < 0 || plan[j].size > plan[i].size)) i = j;
+            }
+            if (i < 0) break;
+            plan[i].size = align_up(plan[i].size);
+            plan[i].offset = first_fit(i, done);
+            done[i] = 1;
+            if (plan[i].offset + plan[i].size > block_size[k]) block_size[k] = plan[i].offset + plan[i].size;
+        }
+    }
+
+    arena_phase = L2_PHASE_SETUP;
+    return (alloc_block(0) || alloc_block(1)) ? -1 : 0;
+}
+
+void l2_arena_close(void)
+{
+    free_block(1);
+    free_block(0);
+}
+
+int l2_arena_phase(int phase)
+{
+    arena_phase = phase;
+    if (phase == L2_PHASE_RUN)
+    {
+        free_block(1);
+        for (int i = 0; i < arena_num; i++)
+        {
+            // the buffers starting their lifetime in the loop are zeroed, as the static buffers they replace
+            l2_buffer_t *b = &arena_plan[i];
+            if ((b->phases & (L2_PHASE_SETUP | L2_PHASE_RUN)) != L2_PHASE_RUN) continue;
+            for (uint32_t k = 0; k < b->size; k++) block[0][b->offset + k] = 0;
+        }
+        return 0;
+    }
+    return (block[1] == NULL) ? alloc_block(1) : 0;
+}
+
+void *l2_arena_get(int id)
+{
+    l2_buffer_t *b = &arena_plan[id];
+    if (!(b->phases & arena_phase) || b->size == 0) return NULL;
+    return block[block_of(b)] + b->offset;
+}
+
+void l2_arena_graph(uint32_t graph_l2)
+{
+    graph_size = graph_l2;
+}
+
+void l2_arena_print(void)
+{
+    static const char *phase_names[L2_PHASES] = { "setup", "run", "flush" };
+    uint32_t peak = 0;
+    printf("L2 arena: persistent %d bytes, scratch %d bytes, graph %d bytes\n", block_size[0], block_size[1], graph_size);
+    for (int p = 0; p < L2_PHASES; p++)
+    {
+        // the scratch block is replaced by the graph in the processing loop
+        uint32_t live = block_size[0] + (((1 << p) == L2_PHASE_RUN) ? graph_size : block_size[1]);
+        if (live > peak) peak = live;
+        printf("%20s: %7d bytes\n", phase_names[p], live);
+    }
+    for (int i = 0; i < arena_num; i++)
+    {
+        l2_buffer_t *b = &arena_plan[i];
+        if (b->size == 0) continue;
+        printf("%20s: %7d bytes at %7d of the %s block\n", b->name, b->size, b->offset, block_of(b) ? "scratch" : "persistent");
+    }
+    printf("L2 peak %d bytes\n", peak);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+
+
+/*
+ * Application L2 arena
+ *
+ * The L2 buffers of the application are declared in a plan with their
+ * lifetime, a contiguous range of the phases below, and placed in the arena:
+ * two buffers share the same bytes if their lifetimes do not intersect.
+ *
+ * The buffers live in the processing loop are placed in a persistent block.
+ * The others (e.g. the wav staging buffers of the file modes) are placed in a
+ * scratch block, which is released when entering the processing loop, so that
+ * the graph constructor takes the same L2 for its own buffer, and allocated
+ * again for the output flush after the graph destructor. The content of the
+ * scratch buffers is not kept across the processing loop.
+ *
+ * The plan of the application is in l2_plan.h: the persistent block is
+ * reserved at build time in the L2 left to the autotiler.
+ */
+#define L2_PHASE_SETUP      (1 << 0)    // input setup: wav load, SFU buffers
+#define L2_PHASE_RUN        (1 << 1)    // processing loop
+#define L2_PHASE_FLUSH      (1 << 2)    // output write back
+#define L2_PHASES           (3)
+
+#define L2_ARENA_ALIGN      (8)
+
+/*
+ * \brief a buffer of the plan, the offset is assigned by l2_arena_open
+ */
+typedef struct {
+    const char *name;
+    uint32_t size;
+    uint32_t phases;    // mask of L2_PHASE_* in which the buffer is live
+    uint32_t offset;
+} l2_buffer_t;
+
+/*
+ * \brief place the buffers of the plan and allocate the arena for the setup phase
+ *
+ * Returns 0 on success, -1 if the arena cannot be allocated.
+ */
+int l2_arena_open(l2_buffer_t *plan, int n);
+
+/*
+ * \brief free the arena
+ */
+void l2_arena_close(void);
+
+/*
+ * \brief enter a phase: L2_PHASE_RUN releases the scratch block, L2_PHASE_FLUSH allocates it again
+ *
+ * The buffers live from L2_PHASE_RUN on are zeroed, as the static buffers
+ * they replace. Returns 0 on success, -1 if the scratch block cannot be allocated.
+ */
+int l2_arena_phase(int phase);
+
+/*
+ * \brief L2 address of the buffer id of the plan, NULL if not live in the current phase
+ */
+void *l2_arena_get(int id);
+
+/*
+ * \brief account the L2 of the graphs, after their construction
+ */
+void l2_arena_graph(uint32_t graph_l2);
+
+/*
+ * \brief print the plan and the L2 live in every phase
+ */
+void l2_arena_print(void);
@@ -0,0 +1,58 @@
+# Host tool of the Makefile: L2 footprint of the linked application image, i.e.
+# the allocated sections (.text, .data, .bss, stacks, ...) of the ELF placed in
+# the L2 address range. The build fails if it exceeds APP_L2_IMAGE, the L2 kept
+# by the Makefile for the image out of the L2 of the autotiler (MODEL_L2_MEMORY).
+
+import sys
+import struct
+import argparse
+
+SHF_ALLOC = 0x2
+
+
+def l2_sections(path, base, size):
+    with open(path, 'rb') as fp:
+        elf = fp.read()
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        raise SystemExit('Error! {} is not a 32 bits little endian ELF file'.format(path))
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+    headers = [struct.unpack_from('<IIIIII', elf, shoff + i * shentsize) for i in range(shnum)]
+    strtab = headers[shstrndx][4]
+
+    sections = []
+    for name, stype, flags, addr, offset, ssize in headers:
+        if not (flags & SHF_ALLOC) or ssize == 0 or not (base <= addr < base + size):
+            continue
+        sname = elf[strtab + name:elf.index(b'\0', strtab + name)].decode()
+        sections.append((sname, addr, ssize))
+    return sections
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'L2 image size', description="L2 footprint of the linked application image")
+
+    parser.add_argument('elf', type=str,
+                        help="Linked application")
+    parser.add_argument('--limit', type=int, required=True,
+                        help="L2 reserved to the image (APP_L2_IMAGE)")
+    parser.add_argument('--l2_base', type=lambda x: int(x, 0), default=0x1C000000,
+                        help="Start address of the L2")
+    parser.add_argument('--l2_size', type=int, default=1572864,
+                        help="Size of the L2")
+    parser.add_argument('--verbose', action="store_true",
+                        help="List the sections in L2")
+
+    args = parser.parse_args()
+    sections = l2_sections(args.elf, args.l2_base, args.l2_size)
+    if args.verbose:
+        for name, addr, ssize in sections:
+            print('{:<24} 0x{:08x} {:>8}'.format(name, addr, ssize))
+
+    # the heap of the OS starts at the end of the image: the L2 below it is used
+    used = max(a + s for _, a, s in sections) - args.l2_base if sections else 0
+    print('L2 image: {} bytes of the {} bytes of APP_L2_IMAGE'.format(used, args.limit))
+    if used > args.limit:
+        print('Error! the L2 image exceeds APP_L2_IMAGE by {} bytes: raise APP_L2_IMAGE'.format(used - args.limit))
+        sys.exit(1)
@@ -0,0 +1,117 @@
+#pragma once
+#include "l2_arena.h"
+#include "resampler.h"
+
+
+/*
+ * L2 plan of the application
+ *
+ * The buffers placed in the L2 arena (l2_arena.h): X(id, name, bytes, phases).
+ * The sizes depend on the build configuration only, so that the plan is also
+ * compiled on the host (l2_plan_size.c) and the persistent block is reserved
+ * at build time in the L2 left to the autotiler (APP_L2_RESERVE, Makefile).
+ * The types of the SDK are accounted with the upper bounds below, checked
+ * against their size in denoiser.c.
+ */
+#define L2_SIGNAL_BYTES         (2)     // DATATYPE_SIGNAL, DATATYPE_SIGNAL_INF
+#define L2_POINTER_BYTES        (4)
+#define L2_CLUSTER_TASK_BYTES   (128)   // struct pi_cluster_task
+#define L2_DEVICE_BYTES         (64)    // pi_device_t
+#define L2_SFU_CHANNEL_BYTES    (256)   // SFU_uDMA_Channel_T
+
+// SFU mode: input/output chunks of a hop (32 bits samples)
+#define BUFF_SIZE (FRAME_STEP*4)
+#define CHUNK_NUM (SFU_CHUNK_NUM)
+
+// NN test mode: packed STFT frames (stft_pack.h) read in chunks of STFT_CHUNK_FRAMES, double buffered
+#define STFT_CHUNK_FRAMES (16)
+
+// file modes: rate of the wav file (read from its header by the Makefile), converted hop by hop
+#ifndef WAV_FS
+#define WAV_FS SAMPLING_FREQ
+#endif
+// new input samples of a resampler call: the first hop resamples a whole frame
+#define RS_IN_MAX   ((FRAME_SIZE * WAV_FS) / SAMPLING_FREQ + 2)
+#define RS_OUT_MAX  (FRAME_SIZE)
+
+#define L2_SPECTRUM_BYTES       (STFT_BINS*AT_INPUT_HEIGHT*L2_SIGNAL_BYTES)
+
+#if defined(MODEL_SET)
+    // the models of the set keep their own states (model_entry.h)
+    #define L2_RNN_STATE_BYTES      (0)
+    #define L2_RNN_C_STATE_BYTES    (0)
+#elif defined(GRU)
+    #define L2_RNN_STATE_BYTES      (H_STATE_LEN*L2_SIGNAL_BYTES)
+    #define L2_RNN_C_STATE_BYTES    (0)
+#else
+    #define L2_RNN_STATE_BYTES      (H_STATE_LEN*L2_SIGNAL_BYTES)
+    #define L2_RNN_C_STATE_BYTES    (H_STATE_LEN*L2_SIGNAL_BYTES)
+#endif
+
+#ifdef METRICS_REF_WAV
+    #define L2_METRICS_CLEAN_BYTES  (FRAME_STEP*sizeof(short))
+#else
+    #define L2_METRICS_CLEAN_BYTES  (0)
+#endif
+
+#if IS_SFU == 0 && IS_INPUT_STFT == 0 && !defined(CHECKSUM)
+    #define L2_WAV_OUT_SIZE denoiser_L2_SIZE
+#else
+    #define L2_WAV_OUT_SIZE 0
+#endif
+
+// the buffers of every mode
+#define L2_PLAN_COMMON(X) \
+    X(L2_AUDIO_FRAME,   "audio frame",   FRAME_NFFT*L2_SIGNAL_BYTES,        L2_PHASE_RUN) \
+    X(L2_AUDIO_TEMP,    "overlap-add",   FRAME_SIZE*L2_SIGNAL_BYTES,        L2_PHASE_RUN) \
+    X(L2_SPECTROGRAM,   "spectrogram",   2*L2_SPECTRUM_BYTES,               L2_PHASE_RUN) \
+    X(L2_MAGNITUDE,     "magnitude",     L2_SPECTRUM_BYTES,                 L2_PHASE_RUN) \
+    X(L2_BANDS,         "band energies", NUM_BANDS*AT_INPUT_HEIGHT*L2_SIGNAL_BYTES, L2_PHASE_RUN) \
+    X(L2_RNN_STATE_0_I, "rnn state 0 i", L2_RNN_STATE_BYTES,                L2_PHASE_RUN) \
+    X(L2_RNN_STATE_1_I, "rnn state 1 i", L2_RNN_STATE_BYTES,                L2_PHASE_RUN) \
+    X(L2_RNN_STATE_0_C, "rnn state 0 c", L2_RNN_C_STATE_BYTES,              L2_PHASE_RUN) \
+    X(L2_RNN_STATE_1_C, "rnn state 1 c", L2_RNN_C_STATE_BYTES,              L2_PHASE_RUN) \
+    X(L2_TASKS,         "cluster tasks", 2*L2_CLUSTER_TASK_BYTES,           L2_PHASE_RUN)
+
+#if IS_SFU == 1
+#define L2_PLAN_IO(X) \
+    X(L2_SFU_CHANNELS,  "uDMA channels", 2*L2_SFU_CHANNEL_BYTES,            L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_SFU_LISTS,     "chunk lists",   2*CHUNK_NUM*L2_POINTER_BYTES,      L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_SFU_IN,        "mic chunks",    CHUNK_NUM*BUFF_SIZE,               L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_SFU_OUT,       "dac chunks",    CHUNK_NUM*BUFF_SIZE,               L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_SLIDER,        "slider i2c",    L2_DEVICE_BYTES,                   L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_PREVIOUS_MASK, "previous mask", L2_SPECTRUM_BYTES,                 L2_PHASE_RUN)
+#elif IS_INPUT_STFT == 0
+// the wav staging buffers are not live in the processing loop and share the L2 of the graph
+#define L2_PLAN_IO(X) \
+    X(L2_WAV_IN,        "wav in",        denoiser_L2_SIZE,                  L2_PHASE_SETUP) \
+    X(L2_WAV_OUT,       "wav out",       L2_WAV_OUT_SIZE,                   L2_PHASE_FLUSH) \
+    X(L2_METRICS_REF,   "input hop",     FRAME_STEP*sizeof(short),          L2_PHASE_RUN) \
+    X(L2_METRICS_CLEAN, "clean hop",     L2_METRICS_CLEAN_BYTES,            L2_PHASE_RUN) \
+    X(L2_RS_IN_MEM,     "resampler in",  resampler_mem_size(WAV_FS, SAMPLING_FREQ, RS_IN_MAX), L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_RS_OUT_MEM,    "resampler out", resampler_mem_size(SAMPLING_FREQ, WAV_FS, RS_OUT_MAX), L2_PHASE_SETUP | L2_PHASE_RUN) \
+    X(L2_RS_FRAME,      "resampled in",  (WAV_FS != SAMPLING_FREQ) ? FRAME_SIZE*sizeof(short) : 0, L2_PHASE_RUN) \
+    X(L2_RS_OUT,        "resampled out", resampler_max_out_size(SAMPLING_FREQ, WAV_FS, RS_OUT_MAX)*sizeof(short), L2_PHASE_RUN)
+#else
+#define L2_PLAN_IO(X) \
+    X(L2_STFT_CHUNKS,   "stft chunks",   2*STFT_CHUNK_FRAMES*STFT_BINS*AT_INPUT_HEIGHT*sizeof(float), L2_PHASE_RUN)
+#endif
+
+#define L2_PLAN(X) L2_PLAN_COMMON(X) L2_PLAN_IO(X)
+
+#define L2_PLAN_ID(id, n, b, p) id,
+enum {
+    L2_PLAN(L2_PLAN_ID)
+    L2_BUFFERS
+};
+
+/*
+ * \brief fill the plan of the current configuration, the offsets are assigned by l2_arena_open
+ */
+static inline void l2_plan_init(l2_buffer_t *plan)
+{
+#define L2_PLAN_ENTRY(id, n, b, p) \
+    plan[id].name = n; plan[id].size = b; plan[id].phases = p; plan[id].offset = 0;
+    L2_PLAN(L2_PLAN_ENTRY)
+#undef L2_PLAN_ENTRY
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2022 GreenWaves Technologies
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ *
+ */
+
+/*
+    Host tool of the Makefile: prints the bytes of the persistent block of the
+    L2 arena (l2_arena.c) for the configuration given with the -D flags of the
+    application. The buffers live in the processing loop all intersect, the
+    block is the sum of their aligned sizes.
+*/
+#include <stdio.h>
+
+// the graph buffer only sizes the scratch block, released for the graph itself
+#define denoiser_L2_SIZE 0
+#include "l2_plan.h"
+
+int main(void)
+{
+    l2_buffer_t plan[L2_BUFFERS];
+    uint32_t persistent = 0;
+
+    l2_plan_init(plan);
+    for (int i = 0; i < L2_BUFFERS; i++)
+    {
+        if (plan[i].phases & L2_PHASE_RUN) persistent += (plan[i].size + L2_ARENA_ALIGN - 1) & ~(L2_ARENA_ALIGN - 1);
+    }
+    printf("%u\n", persistent);
+    return 0;
+}
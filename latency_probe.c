@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include "latency_probe.h"
+
+
+// half width (samples) of the search window around the input position of an impulse
+#ifndef PROBE_WINDOW
+#define PROBE_WINDOW        (64)
+#endif
+// minimum output peak (% of the impulse amplitude) to detect an impulse
+#ifndef PROBE_DETECT_PCT
+#define PROBE_DETECT_PCT    (10)
+#endif
+
+static struct {
+    uint32_t fs;
+    uint32_t period;
+    uint32_t offset;
+    uint32_t out_delay_us;
+    short amplitude;
+    int started;
+    uint32_t t0;            // start of the input stream
+
+    // impulse searched at the output
+    uint32_t next;
+    int peak;
+    uint32_t peak_idx;
+    uint32_t peak_play_us;
+    uint32_t peak_proc_us;
+
+    uint32_t detected;
+    uint32_t missed;
+    uint64_t sum_us;
+    uint64_t sum_proc_us;
+    int32_t sum_shift;      // output peak - input position, samples
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t max_proc_us;
+} probe;
+
+
+static inline uint32_t samples_us(uint32_t n)
+{
+    return (uint32_t) (((uint64_t) n * 1000000) / probe.fs);
+}
+
+// the sample s is received once the next one starts
+static inline uint32_t arrival_us(uint32_t s)
+{
+    return probe.t0 + samples_us(s + 1);
+}
+
+static inline uint32_t impulse_pos(uint32_t j)
+{
+    return probe.offset + j * probe.period;
+}
+
+void probe_reset(uint32_t fs, uint32_t period, uint32_t offset, short amplitude, uint32_t out_delay_us)
+{
+    probe.fs = fs;
+    probe.period = period;
+    probe.offset = offset;
+    probe.amplitude = amplitude;
+    probe.out_delay_us = out_delay_us;
+    probe.started = 0;
+    probe.next = 0;
+    probe.peak = -1;
+    probe.detected = 0;
+    probe.missed = 0;
+    probe.sum_us = 0;
+    probe.sum_proc_us = 0;
+    probe.sum_shift = 0;
+    probe.min_us = 0xFFFFFFFF;
+    probe.max_us = 0;
+    probe.max_proc_us = 0;
+}
+
+void probe_wait(uint32_t samples)
+{
+    if (!probe.started) {
+        probe.t0 = pi_time_get_us();
+        probe.started = 1;
+    }
+    int32_t wait_us = (int32_t) (probe.t0 + samples_us(samples) - pi_time_get_us());
+    if (wait_us > 0) pi_time_wait_us(wait_us);
+}
+
+void probe_inject(short *samples, uint32_t first, int n)
+{
+    uint32_t j = (first > probe.offset) ? (first - probe.offset + probe.period - 1) / probe.period : 0;
+    for (uint32_t p = impulse_pos(j); p < first + n; p = impulse_pos(++j)) {
+        // replaced rather than added: no overflow on loud inputs
+        samples[p - first] = probe.amplitude;
+    }
+}
+
+static void probe_close(void)
+{
+    uint32_t pos = impulse_pos(probe.next);
+    if (probe.peak * 100 >= probe.amplitude * PROBE_DETECT_PCT) {
+        uint32_t us = probe.peak_play_us - arrival_us(pos);
+        probe.detected++;
+        probe.sum_us += us;
+        probe.sum_proc_us += probe.peak_proc_us;
+        probe.sum_shift += (int32_t) (probe.peak_idx - pos);
+        if (us < probe.min_us) probe.min_us = us;
+        if (us > probe.max_us) probe.max_us = us;
+        if (probe.peak_proc_us > probe.max_proc_us) probe.max_proc_us = probe.peak_proc_us;
+    } else {
+        probe.missed++;
+    }
+    probe.next++;
+    probe.peak = -1;
+}
+
+void probe_detect(const short *samples, uint32_t first, int n, uint32_t frame_end)
+{
+    uint32_t now = pi_time_get_us();
+    // from the arrival of the last sample of the frame to the write of the hop
+    uint32_t proc_us = now - arrival_us(frame_end - 1);
+
+    for (int i = 0; i < n; i++) {
+        uint32_t s = first + i;
+        uint32_t pos = impulse_pos(probe.next);
+        if (s > pos + PROBE_WINDOW) {
+            // the next impulse is more than a window later
+            probe_close();
+            continue;
+        }
+        if (s + PROBE_WINDOW < pos) continue;
+
+        int v = abs(samples[i]);
+        if (v > probe.peak) {
+            probe.peak = v;
+            probe.peak_idx = s;
+            // the hop is played sample by sample after the output buffering
+            probe.peak_play_us = now + probe.out_delay_us + samples_us(i);
+            probe.peak_proc_us = proc_us;
+        }
+    }
+}
+
+int probe_print(void)
+{
+    if (probe.detected == 0) {
+        printf("Latency probe: no impulse detected, %d missed\n", probe.missed);
+        return 0;
+    }
+    uint32_t mean_us = (uint32_t) (probe.sum_us / probe.detected);
+    uint32_t mean_proc_us = (uint32_t) (probe.sum_proc_us / probe.detected);
+    uint32_t mean_samples = (uint32_t) (((uint64_t) mean_us * probe.fs) / 1000000);
+    uint32_t algo_us = mean_us - mean_proc_us;
+
+    printf("Latency probe: %d impulses detected, %d missed, output peak shifted by %d samples on average\n",
+        probe.detected, probe.missed, probe.sum_shift / (int32_t) probe.detected);
+    printf("Latency probe: measured input-to-output of the loop %d us (%d samples), min %d us, max %d us\n",
+        mean_us, mean_samples, probe.min_us, probe.max_us);
+    printf("Latency probe: framing and output buffering %d us (%d samples), processing %d us (max %d us)\n",
+        algo_us, (uint32_t) (((uint64_t) algo_us * probe.fs) / 1000000), mean_proc_us, probe.max_proc_us);
+    printf("Latency probe: the audio I/O chain (SFU chunks, PDM filters and resamplers) is not included\n");
+    return probe.detected;
+}
+
+uint32_t probe_max_us(void)
+{
+    return probe.max_us;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+
+
+/*
+ * End-to-end latency probe (APP_MODE 4)
+ *
+ * The file input stands in for the microphone: the samples are released in
+ * real-time from the start of the processing loop (the loop waits for a frame
+ * until its last sample would have been received) and impulses are added to
+ * the input every period samples. At the output, every impulse is searched
+ * around its input position in the hops completed by the overlap-and-add, and
+ * the latency is the time from the arrival of the impulse sample to the play
+ * of the output peak. It is split into the processing time (from the arrival
+ * of the last sample of the frame completing the output hop to the write of
+ * the hop) and the algorithmic rest (framing and output buffering).
+ *
+ * The probe runs at the rate of the processing loop: the audio I/O chain
+ * (SFU chunk buffering, PDM filters and resamplers of the SFU graph, resampling
+ * of the wav file) is not part of the measure, which is reported as the
+ * input-to-output latency of the loop.
+ */
+
+/*
+ * \brief reset the probe, period and offset of the impulses in samples, out_delay_us of buffering after the output write
+ */
+void probe_reset(uint32_t fs, uint32_t period, uint32_t offset, short amplitude, uint32_t out_delay_us);
+
+/*
+ * \brief wait for the arrival of the first samples of the input (real-time pacing from the first call)
+ */
+void probe_wait(uint32_t samples);
+
+/*
+ * \brief add the impulses to the n input samples starting at the sample first of the stream
+ */
+void probe_inject(short *samples, uint32_t first, int n);
+
+/*
+ * \brief search the impulses in the n output samples starting at first, completed by the frame ending at frame_end
+ *
+ * To be called once the output hop is written, in order of the stream.
+ */
+void probe_detect(const short *samples, uint32_t first, int n, uint32_t frame_end);
+
+/*
+ * \brief print the latency statistics over the detected impulses
+ *
+ * Returns the number of impulses detected.
+ */
+int probe_print(void);
+
+/*
+ * \brief worst case latency measured over the detected impulses, in us (0 if none)
+ */
+uint32_t probe_max_us(void);
@@ -0,0 +1,103 @@
+#include "metrics.h"
+
+#include <math.h>
+
+#define METRICS_SEG_SNR_MIN     (-10.0f)
+#define METRICS_SEG_SNR_MAX     (35.0f)
+// segments whose reference is below -60 dBFS are not counted in the segmental SNR
+#define METRICS_SILENCE         (1e-6)
+#define METRICS_MASK_LOW        (0.1f)
+
+
+static void metrics_reset_snr(metrics_snr_t *s)
+{
+    s->hops = 0;
+    s->sig_energy = 0.0;
+    s->err_energy = 0.0;
+    s->seg_sig = 0.0;
+    s->seg_err = 0.0;
+    s->seg_snr_sum = 0.0;
+    s->seg_count = 0;
+}
+
+void metrics_reset(metrics_t *m)
+{
+    metrics_reset_snr(&m->input);
+    metrics_reset_snr(&m->clean);
+    m->clipped = 0;
+    m->mask_frames = 0;
+    m->mask_bins = 0;
+    m->mask_low = 0;
+    m->mask_sum = 0.0;
+    m->mask_min = 1e9f;
+    m->mask_max = -1e9f;
+}
+
+void metrics_update_signal(metrics_snr_t *s, short *ref, short *out, int n)
+{
+    float sig = 0.0f, err = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float r = (float) ref[i] / (1<<15);
+        float e = (float) out[i] / (1<<15) - r;
+        sig += r * r;
+        err += e * e;
+    }
+    // the hop totals are computed in float32 and accumulated in double
+    s->sig_energy += sig;
+    s->err_energy += err;
+    s->seg_sig += sig;
+    s->seg_err += err;
+    s->hops++;
+
+    if ((s->hops % METRICS_SEG_HOPS) == 0) {
+        if (s->seg_sig > METRICS_SILENCE * n * METRICS_SEG_HOPS) {
+            float snr = (s->seg_err > 0.0) ? 10.0f * log10f((float) (s->seg_sig / s->seg_err)) : METRICS_SEG_SNR_MAX;
+            if (snr < METRICS_SEG_SNR_MIN) snr = METRICS_SEG_SNR_MIN;
+            if (snr > METRICS_SEG_SNR_MAX) snr = METRICS_SEG_SNR_MAX;
+            s->seg_snr_sum += snr;
+            s->seg_count++;
+        }
+        s->seg_sig = 0.0;
+        s->seg_err = 0.0;
+    }
+}
+
+void metrics_update_mask(metrics_t *m, METRICS_MASK_TYPE *mask, int n)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float v = (float) mask[i];
+        sum += v;
+        if (v < m->mask_min) m->mask_min = v;
+        if (v > m->mask_max) m->mask_max = v;
+        if (v < METRICS_MASK_LOW) m->mask_low++;
+    }
+    m->mask_sum += sum;
+    m->mask_bins += n;
+    m->mask_frames++;
+}
+
+float metrics_snr(metrics_snr_t *s)
+{
+    if (s->err_energy == 0.0) return 1000000.0f;
+    return (float) (s->sig_energy / s->err_energy);
+}
+
+static void metrics_print_snr(metrics_snr_t *s, const char *ref)
+{
+    printf("Metrics: %d hops against the %s, SNR %.2f dB, segmental SNR %.2f dB (%d segments)\n",
+        s->hops, ref, 10.0f * log10f(metrics_snr(s)),
+        (s->seg_count > 0) ? (float) (s->seg_snr_sum / s->seg_count) : 0.0f, s->seg_count);
+}
+
+void metrics_print(metrics_t *m)
+{
+    if (m->input.hops > 0) metrics_print_snr(&m->input, "input (distance from the noisy input)");
+    if (m->clean.hops > 0) metrics_print_snr(&m->clean, "clean reference");
+    if (m->clipped > 0) printf("Metrics: clipped samples %d\n", m->clipped);
+    if (m->mask_frames > 0) {
+        printf("Metrics: %d masks, mean %.3f, min %.3f, max %.3f, bins below %.1f: %.2f%%\n",
+            m->mask_frames, (float) (m->mask_sum / m->mask_bins), m->mask_min, m->mask_max,
+            METRICS_MASK_LOW, 100.0f * m->mask_low / m->mask_bins);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+
+
+// same datatype of the NN mask
+#ifdef DSP_BFLOAT16
+#define METRICS_MASK_TYPE float16alt
+#else
+#define METRICS_MASK_TYPE float16
+#endif
+
+// hops of a segment of the segmental SNR
+#ifndef METRICS_SEG_HOPS
+#define METRICS_SEG_HOPS (4)
+#endif
+
+/*
+ * \brief SNR of an output stream against a reference stream
+ *
+ * The signal energies are normalized to the Q15 full scale and accumulated in
+ * double precision, so that long runs do not lose the last hops. The segmental
+ * SNR averages the SNR of the segments of METRICS_SEG_HOPS hops, clamped to
+ * [-10, 35] dB, skipping the silent segments of the reference.
+ */
+typedef struct {
+    uint32_t hops;
+    double sig_energy;      // reference energy
+    double err_energy;      // energy of the difference between output and reference
+    double seg_sig;         // energies of the current segment
+    double seg_err;
+    double seg_snr_sum;     // dB
+    uint32_t seg_count;
+} metrics_snr_t;
+
+/*
+ * \brief quality metrics updated hop by hop in constant memory
+ *
+ * input: the output against the input stream, i.e. how far the output is from
+ * the noisy input (the STFT+iSTFT checksum of the APP_MODE 2), not a quality
+ * measure of the denoiser. clean: the output against the clean reference stream
+ * of the same utterance, if any (METRICS_REF_WAV).
+ */
+typedef struct {
+    metrics_snr_t input;
+    metrics_snr_t clean;
+    uint32_t clipped;       // saturated output samples
+    uint32_t mask_frames;
+    uint32_t mask_bins;
+    uint32_t mask_low;      // mask values below 0.1 (more than 20 dB of attenuation)
+    double mask_sum;
+    float mask_min;
+    float mask_max;
+} metrics_t;
+
+/*
+ * \brief clear all the metrics
+ */
+void metrics_reset(metrics_t *m);
+
+/*
+ * \brief accumulate a hop of output samples against the reference ones (Q15)
+ */
+void metrics_update_signal(metrics_snr_t *s, short *ref, short *out, int n);
+
+/*
+ * \brief accumulate the mask of a frame
+ */
+void metrics_update_mask(metrics_t *m, METRICS_MASK_TYPE *mask, int n);
+
+/*
+ * \brief count the output samples saturated by the conversion to the output format
+ */
+static inline void metrics_add_clipping(metrics_t *m, int n)
+{
+    m->clipped += n;
+}
+
+/*
+ * \brief overall SNR in linear scale
+ */
+float metrics_snr(metrics_snr_t *s);
+
+/*
+ * \brief print the metrics accumulated so far
+ */
+void metrics_print(metrics_t *m);
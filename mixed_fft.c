@@ -0,0 +1,194 @@
+#include "mixed_fft.h"
+
+#include "MixedFFTLUT.def"  // window, twiddles and radix plan (model/gen_mixed_fft_lut.py)
+
+#if MIXED_FFT_N != FRAME_NFFT || MIXED_FFT_WIN_SIZE != FRAME_SIZE
+#error "MixedFFTLUT.def does not match the FRAME_SIZE/FRAME_NFFT settings: run make clean"
+#endif
+
+// size of the complex FFT computing the real FFT
+#define MIXED_FFT_M         (FRAME_NFFT / 2)
+#define MIXED_FFT_MAX_RADIX (5)
+
+#define T MIXED_FFT_TYPE
+
+char *L1_Memory;
+
+static PI_L2 int MixedRadixLUT[MIXED_FFT_STAGES] = MIXED_FFT_RADIX_LUT;
+static PI_L2 T MixedWindowLUT[FRAME_SIZE] = MIXED_FFT_WINDOW_LUT;
+static PI_L2 T MixedTwiddlesLUT[2*MIXED_FFT_M] = MIXED_FFT_TWIDDLES_LUT;
+static PI_L2 T MixedRTwiddlesLUT[2*(MIXED_FFT_M+1)] = MIXED_RFFT_TWIDDLES_LUT;
+
+typedef struct {
+    T *in;
+    T *out;
+} mixed_fft_arg_t;
+
+
+// range of the n items processed by the current core
+static inline void core_chunk(int n, int *first, int *last)
+{
+    int chunk = (n + pi_cl_team_nb_cores() - 1) / pi_cl_team_nb_cores();
+    *first = pi_core_id() * chunk;
+    *last = (*first + chunk < n) ? (*first + chunk) : n;
+}
+
+/*
+    radix R butterfly of a Stockham stage, with m = n/R and s the stride of the stage:
+    y[q + s*(R*p + j)] = w^(p*j) * sum_r x[q + s*(p + r*m)] * wR^(r*j)
+*/
+static inline void butterfly(T *x, T *y, int R, int p, int q, int m, int s)
+{
+    T ar[MIXED_FFT_MAX_RADIX], ai[MIXED_FFT_MAX_RADIX];
+    T br[MIXED_FFT_MAX_RADIX], bi[MIXED_FFT_MAX_RADIX];
+
+    for (int r = 0; r < R; r++) {
+        int idx = q + s*(p + r*m);
+        ar[r] = x[2*idx];
+        ai[r] = x[2*idx+1];
+    }
+
+    if (R == 2) {
+        br[0] = ar[0] + ar[1]; bi[0] = ai[0] + ai[1];
+        br[1] = ar[0] - ar[1]; bi[1] = ai[0] - ai[1];
+    } else if (R == 4) {
+        T t0r = ar[0] + ar[2], t0i = ai[0] + ai[2];
+        T t1r = ar[0] - ar[2], t1i = ai[0] - ai[2];
+        T t2r = ar[1] + ar[3], t2i = ai[1] + ai[3];
+        T t3r = ar[1] - ar[3], t3i = ai[1] - ai[3];
+        br[0] = t0r + t2r; bi[0] = t0i + t2i;
+        br[2] = t0r - t2r; bi[2] = t0i - t2i;
+        br[1] = t1r + t3i; bi[1] = t1i - t3r;   // t1 - i*t3
+        br[3] = t1r - t3i; bi[3] = t1i + t3r;   // t1 + i*t3
+    } else {
+        // generic odd radix (3, 5): direct DFT with the roots of unity taken from the twiddles
+        for (int j = 0; j < R; j++) {
+            T sr = ar[0], si = ai[0];
+            for (int r = 1; r < R; r++) {
+                int t = ((r*j) % R) * (MIXED_FFT_M / R);
+                T wr = MixedTwiddlesLUT[2*t], wi = MixedTwiddlesLUT[2*t+1];
+                sr += ar[r]*wr - ai[r]*wi;
+                si += ar[r]*wi + ai[r]*wr;
+            }
+            br[j] = sr; bi[j] = si;
+        }
+    }
+
+    int idx = q + s*R*p;
+    y[2*idx] = br[0]; y[2*idx+1] = bi[0];
+    for (int j = 1; j < R; j++) {
+        // w^(p*j) of the stage (n*s = M) is the twiddle p*j*s of the M points table
+        int t = p*j*s;
+        T wr = MixedTwiddlesLUT[2*t], wi = MixedTwiddlesLUT[2*t+1];
+        idx += s;
+        y[2*idx]   = br[j]*wr - bi[j]*wi;
+        y[2*idx+1] = br[j]*wi + bi[j]*wr;
+    }
+}
+
+/*
+    Stockham autosort complex FFT of M points, executed by all the cores of the team
+    x and y are the ping-pong buffers, the returned buffer holds the output in natural order
+*/
+static T *fft_stages(T *x, T *y)
+{
+    int n = MIXED_FFT_M, s = 1;
+    for (int st = 0; st < MIXED_FFT_STAGES; st++) {
+        int R = MixedRadixLUT[st];
+        int m = n / R;
+        int first, last;
+
+        // the m*s butterflies of the stage are split among the cores
+        core_chunk(m*s, &first, &last);
+        int p = first / s, q = first % s;
+        for (int it = first; it < last; it++) {
+            butterfly(x, y, R, p, q, m, s);
+            if (++q == s) { q = 0; p++; }
+        }
+        pi_cl_team_barrier();
+
+        T *tmp = x; x = y; y = tmp;
+        n = m;
+        s *= R;
+    }
+    return x;
+}
+
+static void rfft_core(void *arg)
+{
+    T *in = ((mixed_fft_arg_t *) arg)->in;
+    T *out = ((mixed_fft_arg_t *) arg)->out;
+    T *x = (T *) L1_Memory;
+    T *y = x + 2*MIXED_FFT_M;
+    int first, last;
+
+    // windowing and packing of the even/odd samples as real/imaginary parts
+    core_chunk(MIXED_FFT_M, &first, &last);
+    for (int i = first; i < last; i++) {
+        x[2*i]   = (2*i   < FRAME_SIZE) ? in[2*i]   * MixedWindowLUT[2*i]   : (T) 0.0f;
+        x[2*i+1] = (2*i+1 < FRAME_SIZE) ? in[2*i+1] * MixedWindowLUT[2*i+1] : (T) 0.0f;
+    }
+    pi_cl_team_barrier();
+
+    T *z = fft_stages(x, y);
+
+    // split stage: X[k] = (Z[k] + Z*[M-k])/2 + e^(-2*pi*i*k/N) * (Z[k] - Z*[M-k])/(2i)
+    core_chunk(MIXED_FFT_M + 1, &first, &last);
+    for (int k = first; k < last; k++) {
+        int k0 = (k == MIXED_FFT_M) ? 0 : k;
+        int k1 = (k == 0) ? 0 : MIXED_FFT_M - k;
+        T zr = z[2*k0], zi = z[2*k0+1];
+        T cr = z[2*k1], ci = -z[2*k1+1];
+        T er = (zr + cr) * (T) 0.5f, ei = (zi + ci) * (T) 0.5f;
+        T fo_r = (zi - ci) * (T) 0.5f, fo_i = (cr - zr) * (T) 0.5f;
+        T wr = MixedRTwiddlesLUT[2*k], wi = MixedRTwiddlesLUT[2*k+1];
+        out[2*k]   = er + fo_r*wr - fo_i*wi;
+        out[2*k+1] = ei + fo_r*wi + fo_i*wr;
+    }
+}
+
+static void irfft_core(void *arg)
+{
+    T *in = ((mixed_fft_arg_t *) arg)->in;
+    T *out = ((mixed_fft_arg_t *) arg)->out;
+    T *x = (T *) L1_Memory;
+    T *y = x + 2*MIXED_FFT_M;
+    int first, last;
+
+    // merge stage: Z[k] = Fe[k] + i*Fo[k], stored conjugated to compute the inverse with the forward FFT
+    core_chunk(MIXED_FFT_M, &first, &last);
+    for (int k = first; k < last; k++) {
+        T xr = in[2*k], xi = in[2*k+1];
+        T cr = in[2*(MIXED_FFT_M-k)], ci = -in[2*(MIXED_FFT_M-k)+1];
+        T er = (xr + cr) * (T) 0.5f, ei = (xi + ci) * (T) 0.5f;
+        T dr = (xr - cr) * (T) 0.5f, di = (xi - ci) * (T) 0.5f;
+        // Fo = d * e^(+2*pi*i*k/N)
+        T wr = MixedRTwiddlesLUT[2*k], wi = -MixedRTwiddlesLUT[2*k+1];
+        T fo_r = dr*wr - di*wi, fo_i = dr*wi + di*wr;
+        x[2*k]   = er - fo_i;
+        x[2*k+1] = -(ei + fo_r);
+    }
+    // the input is fully read before the output is written: in and out can be the same buffer
+    pi_cl_team_barrier();
+
+    T *z = fft_stages(x, y);
+
+    // conjugate back and normalize: the even/odd samples are the real/imaginary parts
+    T scale = (T) (1.0f / MIXED_FFT_M);
+    for (int i = first; i < last; i++) {
+        out[2*i]   =  z[2*i]   * scale;
+        out[2*i+1] = -z[2*i+1] * scale;
+    }
+}
+
+void MixedRFFT(T *in, T *out)
+{
+    mixed_fft_arg_t arg = { in, out };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), rfft_core, &arg);
+}
+
+void MixedIRFFT(T *in, T *out)
+{
+    mixed_fft_arg_t arg = { in, out };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), irfft_core, &arg);
+}
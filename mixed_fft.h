@@ -0,0 +1,39 @@
+#pragma once
+#include "pmsis.h"
+
+
+// same datatype of the DSP buffers of the application
+#ifdef DSP_BFLOAT16
+#define MIXED_FFT_TYPE float16alt
+#else
+#define MIXED_FFT_TYPE float16
+#endif
+
+// L1 working buffers: two ping-pong buffers of N/2 complex values
+#define MIXED_FFT_L1_SIZE (2 * FRAME_NFFT * sizeof(MIXED_FFT_TYPE))
+
+/*
+ * \brief L1 area of the transforms, allocated by the caller before sending the cluster task
+ *
+ * Same interface as the generated RFFTKernels, so that the application
+ * allocates and frees the L1 memory of both implementations the same way.
+ */
+extern char *L1_Memory;
+#define _L1_Memory_SIZE MIXED_FFT_L1_SIZE
+
+/*
+ * \brief windowed real FFT of FRAME_NFFT points, to be called from the cluster master core
+ *
+ * FRAME_NFFT/2 must factor into radix 2, 3, 4 and 5 (e.g. 400 points).
+ * in: FRAME_SIZE samples, zero padded up to FRAME_NFFT
+ * out: FRAME_NFFT/2+1 complex bins (real and imaginary parts interleaved)
+ */
+void MixedRFFT(MIXED_FFT_TYPE *in, MIXED_FFT_TYPE *out);
+
+/*
+ * \brief inverse real FFT of FRAME_NFFT points, to be called from the cluster master core
+ *
+ * in: FRAME_NFFT/2+1 complex bins (real and imaginary parts interleaved)
+ * out: FRAME_NFFT samples, it can be the same buffer of the input
+ */
+void MixedIRFFT(MIXED_FFT_TYPE *in, MIXED_FFT_TYPE *out);
@@ -2,6 +2,9 @@
 #include "AutoTilerLibTypes.h"
 #include "DSP_Generators.h"
 
+#ifndef STFT_DATATYPE
+#define STFT_DATATYPE FLOAT16
+#endif
 
 void FFTConfiguration(unsigned int L1Memory)
 {
@@ -35,7 +38,7 @@ int main(int argc, char **argv)
       0,          // NoWindow
       1,          // OutFFT
       0,          // MagSquared
-      FLOAT16     // datatype
+      STFT_DATATYPE // datatype
     );
 
     IRFFT_2D_Generator(
@@ -44,7 +47,7 @@ int main(int argc, char **argv)
       1,          // all the frames
       N_FFT,      // Nfft
       0,          // InvertWindow, bypassed and manually inserted
-      FLOAT16     // datatype
+      STFT_DATATYPE // datatype
     );
 
     GenerateTilingCode();
@@ -0,0 +1,102 @@
+# The script builds the band compression tables of the TinyDenoiser frontend:
+# the STFT bins are pooled into a smaller number of bands (ERB or mel spaced)
+# before the NN and the band mask is expanded back to the bins afterwards.
+#
+# Triangular bands are used, so that every bin is shared between (at most) two
+# adjacent bands with weights w and 1-w. The same tables are used by the GAP
+# application (generated .def file) and by the python tests (test_GAP.py), so
+# that compact models are trained and quantized on the same features.
+
+import argparse
+import numpy as np
+
+
+def hz_to_scale(f, scale):
+    if scale == 'erb':
+        return 21.4 * np.log10(1 + 0.00437 * f)
+    elif scale == 'mel':
+        return 2595.0 * np.log10(1 + f / 700.0)
+    raise ValueError('Band scale not supported: ' + scale)
+
+def scale_to_hz(s, scale):
+    if scale == 'erb':
+        return (10 ** (s / 21.4) - 1) / 0.00437
+    elif scale == 'mel':
+        return 700.0 * (10 ** (s / 2595.0) - 1)
+    raise ValueError('Band scale not supported: ' + scale)
+
+def band_centers(n_bins, n_bands, sr, scale):
+    # centers uniformly spaced on the perceptual scale, expressed in bins
+    f_max = sr / 2
+    s = np.linspace(hz_to_scale(0.0, scale), hz_to_scale(f_max, scale), n_bands)
+    c = scale_to_hz(s, scale) / f_max * (n_bins - 1)
+
+    # at low frequencies the bands get narrower than a bin:
+    # keep at least one bin between two centers so that no band is empty
+    c[0] = 0.0
+    for i in range(1, n_bands):
+        c[i] = min(max(c[i], c[i-1] + 1.0), (n_bins - 1) - (n_bands - 1 - i))
+    return c
+
+def band_tables(n_bins, n_bands, sr=16000, scale='erb'):
+    """
+    Returns for every bin the lower band index and its weight (1-weight goes to
+    the next band), and for every band the inverse of the sum of its weights.
+    """
+    if n_bands < 2 or n_bands > n_bins:
+        raise ValueError('Number of bands must be in [2, {}]'.format(n_bins))
+
+    c = band_centers(n_bins, n_bands, sr, scale)
+    idx = np.zeros(n_bins, dtype=np.int32)
+    weight = np.zeros(n_bins, dtype=np.float32)
+    for k in range(n_bins):
+        b = int(np.searchsorted(c, k, side='right')) - 1
+        b = min(max(b, 0), n_bands - 2)
+        w = (c[b+1] - k) / (c[b+1] - c[b])
+        idx[k] = b
+        weight[k] = min(max(w, 0.0), 1.0)
+
+    wsum = np.zeros(n_bands, dtype=np.float32)
+    np.add.at(wsum, idx, weight)
+    np.add.at(wsum, idx + 1, 1.0 - weight)
+    norm = 1.0 / wsum
+    return idx, weight, norm
+
+def band_pool(mag, idx, weight, norm):
+    # weighted average of the bin magnitudes of every band
+    bands = np.zeros(norm.shape[0], dtype=np.float32)
+    np.add.at(bands, idx, weight * mag)
+    np.add.at(bands, idx + 1, (1.0 - weight) * mag)
+    return bands * norm
+
+def band_expand(mask, idx, weight):
+    # linear interpolation of the band mask over the bins
+    return weight * mask[idx] + (1.0 - weight) * mask[idx + 1]
+
+
+def _array(values, fmt):
+    return '{' + ', '.join(fmt.format(v) for v in values) + '}'
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'Band LUT generator', description="Generate the band pooling/expansion tables of the TinyDenoiser frontend")
+    parser.add_argument('--band_lut_file', type=str, required=True,
+                        help="Output .def file")
+    parser.add_argument('--n_fft', type=int, default=512)
+    parser.add_argument('--num_bands', type=int, default=64)
+    parser.add_argument('--sample_rate', type=int, default=16000)
+    parser.add_argument('--band_scale', type=str, default='erb',
+                        help="erb | mel")
+    args = parser.parse_args()
+
+    n_bins = args.n_fft // 2 + 1
+    idx, weight, norm = band_tables(n_bins, args.num_bands, args.sample_rate, args.band_scale)
+
+    with open(args.band_lut_file, 'w') as fp:
+        fp.write('/* Band tables: {} bins into {} {} bands */\n'.format(n_bins, args.num_bands, args.band_scale))
+        fp.write('#define BAND_LUT_BINS {}\n'.format(n_bins))
+        fp.write('#define BAND_LUT_BANDS {}\n'.format(args.num_bands))
+        fp.write('#define BAND_IDX_LUT {}\n'.format(_array(idx, '{:d}')))
+        fp.write('#define BAND_WEIGHT_LUT {}\n'.format(_array(weight, '{:.6f}')))
+        fp.write('#define BAND_NORM_LUT {}\n'.format(_array(norm, '{:.6f}')))
+    print('Band tables written to: ', args.band_lut_file)
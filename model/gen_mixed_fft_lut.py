@@ -0,0 +1,64 @@
+# The script builds the tables of the mixed-radix real FFT (mixed_fft.c) used
+# when FRAME_NFFT is not a power of two (e.g. a native 400-points transform).
+#
+# The real FFT of N points is computed as a complex FFT of M=N/2 points followed
+# by a split stage. The complex FFT is a Stockham autosort FFT: the radix plan
+# is stored instead of a swap (bit reversal) table, since the output of the
+# last stage is already in natural order.
+
+import argparse
+import numpy as np
+
+SUPPORTED_RADIX = [4, 2, 5, 3]
+
+
+def radix_plan(m):
+    plan = []
+    for r in SUPPORTED_RADIX:
+        while m % r == 0:
+            plan.append(r)
+            m //= r
+    if m != 1:
+        raise ValueError('N/2 must factor into radix {}'.format(SUPPORTED_RADIX))
+    return plan
+
+def _array(values, fmt):
+    return '{' + ', '.join(fmt.format(v) for v in values) + '}'
+
+def _complex_array(values):
+    return _array(np.stack([values.real, values.imag], axis=-1).reshape(-1), '{:.8f}')
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'Mixed-radix FFT LUT generator', description="Generate the window and twiddle tables of the mixed-radix real FFT")
+    parser.add_argument('--fft_lut_file', type=str, required=True,
+                        help="Output .def file")
+    parser.add_argument('--frame_size', type=int, default=400)
+    parser.add_argument('--n_fft', type=int, default=400)
+    args = parser.parse_args()
+
+    n = args.n_fft
+    if n % 2 or args.frame_size > n:
+        raise ValueError('n_fft must be even and not smaller than the frame size')
+    m = n // 2
+    plan = radix_plan(m)
+
+    # periodic hanning window, zero padded up to n_fft
+    window = np.zeros(n)
+    window[:args.frame_size] = 0.5 - 0.5 * np.cos(2 * np.pi * np.arange(args.frame_size) / args.frame_size)
+    # twiddles of the complex FFT: exp(-2*pi*i*k/M)
+    twiddles = np.exp(-2j * np.pi * np.arange(m) / m)
+    # twiddles of the real split stage: exp(-2*pi*i*k/N)
+    rtwiddles = np.exp(-2j * np.pi * np.arange(m + 1) / n)
+
+    with open(args.fft_lut_file, 'w') as fp:
+        fp.write('/* Mixed-radix real FFT tables: N={}, radix plan {} */\n'.format(n, plan))
+        fp.write('#define MIXED_FFT_N {}\n'.format(n))
+        fp.write('#define MIXED_FFT_WIN_SIZE {}\n'.format(args.frame_size))
+        fp.write('#define MIXED_FFT_STAGES {}\n'.format(len(plan)))
+        fp.write('#define MIXED_FFT_RADIX_LUT {}\n'.format(_array(plan, '{:d}')))
+        fp.write('#define MIXED_FFT_WINDOW_LUT {}\n'.format(_array(window[:args.frame_size], '{:.8f}')))
+        fp.write('#define MIXED_FFT_TWIDDLES_LUT {}\n'.format(_complex_array(twiddles)))
+        fp.write('#define MIXED_RFFT_TWIDDLES_LUT {}\n'.format(_complex_array(rtwiddles)))
+    print('Mixed-radix FFT tables written to: ', args.fft_lut_file)
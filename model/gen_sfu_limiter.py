@@ -0,0 +1,118 @@
+# The script builds the parameters of the output limiter of the SFU graph
+# (Graph.src), a LIMITER node at SAMPLING_FREQ before the output resampler.
+#
+# The gain follows a soft knee limiter curve: unity gain below the knee, and
+# an output level growing with a quadratic (dB) knee of width knee_db up to the
+# ceiling, reached with zero slope at the top of the knee:
+#   y_db = x_db - (x_db - ceiling_db + knee_db/2)^2 / (2 knee_db)
+# The SFU node takes the knee thresholds (Q23, 1.0 is the full scale), the gain
+# in the knee as a 5th order polynomial of the envelope (Q25, highest order
+# first) and the smoothing coefficients of the gain and of the envelope (Q23
+# pairs a, 1-a, the envelope updated every `decimation` samples).
+# The input limiter of the graph uses the same curve, ceiling 0 dBFS and 9 dB knee.
+#
+# The output must stay below the full scale: the script fails if the curve of
+# the quantized parameters exceeds it anywhere in the knee.
+
+import argparse
+import numpy as np
+
+Q23 = 1 << 23
+Q25 = 1 << 25
+
+
+def knee_curve(x, ceiling_db, knee_db):
+    # output level of the input level x (linear) in the knee
+    x_db = 20 * np.log10(x)
+    y_db = x_db - (x_db - ceiling_db + knee_db / 2) ** 2 / (2 * knee_db)
+    return 10 ** (y_db / 20)
+
+def smooth_pair(a):
+    a = int(round(a * Q23))
+    return a, Q23 - 1 - a
+
+def limiter_params(args):
+    lo = 10 ** ((args.ceiling_db - args.knee_db / 2) / 20)
+    hi = 10 ** ((args.ceiling_db + args.knee_db / 2) / 20)
+    k_low, k_up = int(round(lo * Q23)), int(round(hi * Q23))
+    lo, hi = k_low / Q23, k_up / Q23
+
+    # gain of the knee, fitted on the envelope levels
+    x = np.linspace(lo, hi, 1024)
+    coeffs = np.polyfit(x, knee_curve(x, args.ceiling_db, args.knee_db) / x, 5)
+    hc = [int(round(c * Q25)) for c in coeffs]
+
+    # the quantized curve must stay below the ceiling: scale the gain down if the fit overshoots
+    ceiling = 10 ** (args.ceiling_db / 20)
+    peak = np.max(x * np.polyval(np.array(hc) / Q25, x))
+    if peak > ceiling:
+        hc = [int(np.floor(c * ceiling / peak)) for c in hc]
+
+    # release: time constant of the envelope in updates (SAMPLING_FREQ / decimation)
+    release = np.exp(-args.decimation / (args.release_ms * 1e-3 * args.sample_rate))
+    gain = np.exp(-args.decimation / (args.gain_ms * 1e-3 * args.sample_rate))
+    params = {
+        'gain_smooth': smooth_pair(gain),
+        'env_up': (Q23 // 2, Q23 // 2),
+        'env_down': smooth_pair(release),
+        'knee': (k_low, k_up),
+        'hc': hc,
+    }
+    return params, x
+
+def check_full_scale(params, x):
+    hc = np.array(params['hc']) / Q25
+    y = x * np.polyval(hc, x)
+    peak_db = 20 * np.log10(np.max(y))
+    unity_db = 20 * np.log10(np.polyval(hc, x[0]))
+    if np.max(y) >= 1.0:
+        raise SystemExit('Error! the output limiter exceeds the full scale: peak {:.3f} dBFS'.format(peak_db))
+    if abs(unity_db) > 0.1:
+        raise SystemExit('Error! the gain at the bottom of the knee is {:.3f} dB instead of unity'.format(unity_db))
+    return peak_db
+
+def write_def(path, params, decimation):
+    p = params
+    with open(path, 'w') as fp:
+        fp.write('/* output limiter of the SFU graph, generated by model/gen_sfu_limiter.py */\n')
+        fp.write('#define LIMITER_OUT_DECIMATION {}\n'.format(decimation))
+        fp.write('#define LIMITER_OUT \\\n')
+        fp.write('            { \\\n                LIMITER, \\\n                { \\\n')
+        fp.write('                    {}, {},   /* gain smooth */ \\\n'.format(*p['gain_smooth']))
+        fp.write('                    {}, {},   /* envelope smooth up */ \\\n'.format(*p['env_up']))
+        fp.write('                    {}, {},   /* envelope smooth down */ \\\n'.format(*p['env_down']))
+        fp.write('                    {}, {},   /* knee thresholds */ \\\n'.format(*p['knee']))
+        fp.write('                    {} /* knee coeffs */ \\\n'.format(', '.join(str(c) for c in p['hc'])))
+        fp.write('                } \\\n            }\n')
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'SFU output limiter', description="Parameters of the output limiter of the SFU graph")
+
+    parser.add_argument('--limiter_file', type=str, required=True,
+                        help="Generated .def file, included by Graph.src")
+    parser.add_argument('--ceiling_db', type=float, default=-1.0,
+                        help="Output ceiling in dBFS, below the full scale for the overshoot of the output resampler")
+    parser.add_argument('--knee_db', type=float, default=6.0,
+                        help="Width of the soft knee in dB, centered on the ceiling")
+    parser.add_argument('--release_ms', type=float, default=200.0,
+                        help="Release time constant of the envelope")
+    parser.add_argument('--gain_ms', type=float, default=125.0,
+                        help="Time constant of the gain smoothing")
+    parser.add_argument('--sample_rate', type=int, default=16000,
+                        help="Rate of the limiter node (SAMPLING_FREQ)")
+    parser.add_argument('--decimation', type=int, default=20,
+                        help="Samples between two envelope updates")
+
+    args = parser.parse_args()
+    if args.ceiling_db > 0.0:
+        parser.error('The ceiling must not exceed the full scale (0 dBFS)')
+    if args.knee_db <= 0.0:
+        parser.error('The knee width must be positive')
+
+    params, x = limiter_params(args)
+    peak_db = check_full_scale(params, x)
+    write_def(args.limiter_file, params, args.decimation)
+    print('Output limiter: knee {:.1f} dB, ceiling {:.2f} dBFS, peak of the quantized curve {:.3f} dBFS'.format(
+        args.knee_db, args.ceiling_db, peak_db))
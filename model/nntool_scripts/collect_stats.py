@@ -18,6 +18,18 @@ quant_sample_path = sys.argv[1]
 quantization_bits = sys.argv[2]
 gru = int(sys.argv[3])
 h_state_len = int(sys.argv[5])
+# optional band compression frontend (NUM_BANDS, BAND_SCALE)
+num_bands = int(sys.argv[6]) if len(sys.argv) > 6 else 0
+band_scale = sys.argv[7] if len(sys.argv) > 7 else 'erb'
+# FFT size (FRAME_NFFT), 400 with the mixed-radix FFT
+n_fft = int(sys.argv[8]) if len(sys.argv) > 8 else 512
+# sampling rate (SAMPLING_FREQ), 8000 in the narrowband mode
+sample_rate = int(sys.argv[9]) if len(sys.argv) > 9 else 16000
+# framing of the build (FRAME_SIZE, FRAME_STEP), e.g. 96/32 with LOW_LATENCY, and frame size
+# of the training (TRAIN_FRAME_SIZE) the magnitudes are rescaled to, as MAG_SCALE in denoiser.c
+frame_size = int(sys.argv[10]) if len(sys.argv) > 10 else 400 * sample_rate // 16000
+frame_step = int(sys.argv[11]) if len(sys.argv) > 11 else frame_size // 4
+train_frame_size = int(sys.argv[12]) if len(sys.argv) > 12 else frame_size
 
 print(gru)
 
@@ -40,10 +52,18 @@ print("Going to collect the quantization stats and store into: " + quantization_
 print('The calibration samples are taken from: ', quant_sample_path)
 
 # parameters
-SR = 16000
+SR = sample_rate
+win_length = frame_size
+hop_length = frame_step
 use_ema = False
 lstm_hidden_states = h_state_len
 
+if num_bands > 0:
+	sys.path.insert(0, 'model')
+	from gen_band_lut import band_tables, band_pool
+	band_idx, band_weight, band_norm = band_tables(n_fft // 2 + 1, num_bands, SR, band_scale)
+	print('Input pooled into {} {} bands'.format(num_bands, band_scale))
+
 # defines
 executer = GraphExecuter(G, qrecs=None)
 
@@ -55,9 +75,9 @@ G.quantization = None
 for filename in os.listdir(quant_sample_path):
 	input_file = quant_sample_path + filename
 	data, _ = librosa.load(input_file, sr=SR)
-	stft = librosa.stft(data, n_fft=512, hop_length=100, win_length=400, 
+	stft = librosa.stft(data, n_fft=n_fft, hop_length=hop_length, win_length=win_length, 
 		window='hann', center=False )
-	rstft = np.abs(stft)
+	rstft = np.abs(stft) * train_frame_size / win_length
 	len_seq = rstft.shape[1]
 
 	#init lstm to zeros
@@ -75,6 +95,8 @@ for filename in os.listdir(quant_sample_path):
 
 	for i in range(len_seq): 
 		single_mags = rstft[:,i]
+		if num_bands > 0:
+			single_mags = band_pool(single_mags, band_idx, band_weight, band_norm)
 
 		if gru == 1:
 			data = [single_mags, lstm_0_i_state, lstm_1_i_state]
@@ -0,0 +1,65 @@
+# The script prefixes the global symbols of an Autotiler generated graph, so that
+# several graphs can be linked in the same application (MODEL_SET).
+#
+# Only the graph API (<prefix>CNN, <prefix>CNN_Construct, <prefix>_L1_Memory, ...)
+# is prefixed by the generator: the layer kernels (e.g. S4_Conv2d_...) and the
+# performance tables (AT_GraphPerf, AT_GraphNodeNames, ...) have the same names
+# in every graph. Every global defined at file scope by the generated sources is
+# renamed <prefix>_<name> in the sources and in the headers of the graph, the
+# symbols of the libraries and of the application (e.g. DefaultRam) are untouched.
+# The kernels of the expressions of the graph (Expression_Kernels.c/.h, fixed
+# names) are prefixed as well. The generator source (<prefix>Model.c) is left as is.
+# The script can be run more than once on the same directory.
+
+import argparse
+import glob
+import os
+import re
+
+# file scope definition: type and name at the start of the line, followed by (, [, = or ;
+DEFINITION = re.compile(r'^(?!static\b|extern\b|typedef\b|return\b)[A-Za-z_][\w \t\*]*?\b([A-Za-z_]\w*)\s*(\(|\[|=|;)')
+# e.g. void __attribute__ ((noinline)) S4_Conv2d_...(
+ATTRIBUTE = re.compile(r'__attribute__\s*\(\(.*?\)\)\s*')
+
+
+def global_definitions(source):
+    names = set()
+    for line in source.splitlines():
+        m = DEFINITION.match(ATTRIBUTE.sub('', line))
+        if m:
+            names.add(m.group(1))
+    return names
+
+def prefix_symbols(build_dir, prefix):
+    sources = glob.glob(os.path.join(build_dir, prefix + 'Kernels.c')) + \
+        glob.glob(os.path.join(build_dir, 'Expression_Kernels.c'))
+    headers = glob.glob(os.path.join(build_dir, prefix + 'Kernels.h')) + \
+        glob.glob(os.path.join(build_dir, 'Expression_Kernels.h'))
+    names = set()
+    for filename in sources:
+        with open(filename) as fp:
+            names |= global_definitions(fp.read())
+    names = sorted(n for n in names if not n.startswith(prefix) and not n.startswith('_' + prefix))
+    if not names:
+        return 0
+    pattern = re.compile(r'\b(' + '|'.join(map(re.escape, names)) + r')\b')
+    for filename in sources + headers:
+        with open(filename) as fp:
+            text = fp.read()
+        text = pattern.sub(lambda m: prefix + '_' + m.group(1), text)
+        with open(filename, 'w') as fp:
+            fp.write(text)
+    return len(names)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'Graph symbols', description="Prefix the global symbols of a generated graph")
+    parser.add_argument('--prefix', type=str, required=True,
+                        help="MODEL_PREFIX of the graph")
+    parser.add_argument('build_dir', type=str,
+                        help="Directory of the generated graph (<prefix>Kernels.c/.h, Expression_Kernels.c/.h)")
+    args = parser.parse_args()
+
+    n = prefix_symbols(args.build_dir, args.prefix)
+    print('{}: {} symbols prefixed with {}_'.format(args.build_dir, n, args.prefix))
@@ -0,0 +1,65 @@
+#pragma once
+#include "model_set.h"
+
+
+/*
+ * Entry of a graph in the model set, included by <prefix>_entry.c after the
+ * header of the model (__PREFIX). MODEL_ENTRY_LSTM selects the LSTM signature
+ * (hidden and cell states), the GRU one otherwise. The length of the states of
+ * every graph is <prefix>_STATE_LEN, set by model_set.mk.
+ */
+#ifndef __XSTR
+#define __XSTR(__s) __STR(__s)
+#define __STR(__s) #__s
+#endif
+
+AT_DEFAULTFLASH_FS_EXT_ADDR_TYPE __PREFIX(_L3_Flash) = 0;
+
+#define ENTRY_STATE_LEN __PREFIX(_STATE_LEN)
+
+// states of the model, preserved between the hops it runs
+static PI_L2 short int State_0_I[ENTRY_STATE_LEN];
+static PI_L2 short int State_1_I[ENTRY_STATE_LEN];
+#ifdef MODEL_ENTRY_LSTM
+static PI_L2 short int State_0_C[ENTRY_STATE_LEN];
+static PI_L2 short int State_1_C[ENTRY_STATE_LEN];
+#endif
+
+static int entry_construct(void)
+{
+    return __PREFIX(CNN_Construct)();
+}
+
+static int entry_destruct(void)
+{
+    return __PREFIX(CNN_Destruct)();
+}
+
+static void entry_run(void *io, int reset)
+{
+    __PREFIX(CNN)(
+#ifdef MODEL_ENTRY_LSTM
+        (void *) State_1_C,
+        (void *) State_0_C,
+#endif
+        (void *) State_1_I,
+        (void *) State_0_I,
+        io,
+        reset,
+        reset,
+        io
+    );
+}
+
+model_entry_t __PREFIX(_Entry) = {
+    .name = __XSTR(__PREFIX()),
+    .construct = entry_construct,
+    .destruct = entry_destruct,
+    .run = entry_run,
+    .l1_memory = (void **) &__PREFIX(_L1_Memory),
+    .l1_size = denoiser_L1_SIZE,
+    .l2_memory = (void **) &__PREFIX(_L2_Memory_Dyn),
+    .l2_dyn_size = denoiser_L2_DYN_SIZE,
+    .l2_size = denoiser_L2_SIZE,
+    .state_len = ENTRY_STATE_LEN,
+};
@@ -0,0 +1,222 @@
+#include <string.h>
+#include "model_set.h"
+
+
+// a better model is taken only if its cost stays below this share (%) of the budget
+#ifndef MODEL_UP_THRESHOLD
+#define MODEL_UP_THRESHOLD  (80)
+#endif
+// consecutive hops below the up threshold before stepping up
+#ifndef MODEL_UP_HOPS
+#define MODEL_UP_HOPS       (64)
+#endif
+
+// sorted by decreasing cost after the construction
+static model_entry_t *model_table[MODEL_SET_MAX];
+static uint32_t cost[MODEL_SET_MAX];    // cluster cycles per hop, running average
+static uint32_t residency[MODEL_SET_MAX];
+static int num_models;
+static int cur_model;
+static int up_cnt;
+static int reset_pending;
+static uint32_t cap_cycles;
+static int pinned_model = -1;
+static uint32_t switch_cnt;
+
+static void *l1_arena;
+static uint32_t l1_arena_size;
+static void *l2_arena;
+static uint32_t l2_arena_size;
+static struct pi_cluster_task calib_task;
+
+
+static uint32_t cl_mhz(void)
+{
+    return pi_freq_get(PI_FREQ_DOMAIN_CL) / (1000*1000);
+}
+
+static void set_model(int m)
+{
+    if (m == cur_model) return;
+    cur_model = m;
+    up_cnt = 0;
+    reset_pending = 1;
+    switch_cnt++;
+}
+
+static void calib_run(void *io)
+{
+    model_table[cur_model]->run(io, 1);
+}
+
+void model_set_add(model_entry_t *m)
+{
+    if (num_models < MODEL_SET_MAX) model_table[num_models++] = m;
+}
+
+int model_set_construct(struct pi_device *cluster, void *io)
+{
+    l1_arena_size = 0;
+    l2_arena_size = 0;
+    for (int i = 0; i < num_models; i++)
+    {
+        int err = model_table[i]->construct();
+        if (err) return err;
+        // the L1 and the dynamic L2 are only used within a call of the graph:
+        // the graphs share the arenas allocated below
+        if (model_table[i]->l1_size > 0)
+        {
+            pi_l1_free(cluster, *model_table[i]->l1_memory, model_table[i]->l1_size);
+            if (model_table[i]->l1_size > l1_arena_size) l1_arena_size = model_table[i]->l1_size;
+        }
+        if (model_table[i]->l2_dyn_size > 0)
+        {
+            pi_l2_free(*model_table[i]->l2_memory, model_table[i]->l2_dyn_size);
+            if (model_table[i]->l2_dyn_size > l2_arena_size) l2_arena_size = model_table[i]->l2_dyn_size;
+        }
+    }
+    l1_arena = pi_l1_malloc(cluster, l1_arena_size);
+    if (l1_arena == NULL) return -1;
+    if (l2_arena_size > 0)
+    {
+        l2_arena = pi_l2_malloc(l2_arena_size);
+        if (l2_arena == NULL) return -1;
+    }
+    for (int i = 0; i < num_models; i++)
+    {
+        if (model_table[i]->l1_size > 0) *model_table[i]->l1_memory = l1_arena;
+        if (model_table[i]->l2_dyn_size > 0) *model_table[i]->l2_memory = l2_arena;
+    }
+
+    // cost of every model at the current cluster frequency
+    pi_cluster_task(&calib_task, calib_run, io);
+    pi_cluster_task_stacks(&calib_task, NULL, SLAVE_STACK_SIZE);
+    for (int i = 0; i < num_models; i++)
+    {
+        cur_model = i;
+        uint32_t t = pi_time_get_us();
+        pi_cluster_send_task_to_cl(cluster, &calib_task);
+        cost[i] = (pi_time_get_us() - t) * cl_mhz();
+    }
+
+    // rank by decreasing cost: the heavier models are assumed to give the better masks
+    for (int i = 1; i < num_models; i++)
+    {
+        for (int j = i; j > 0 && cost[j] > cost[j-1]; j--)
+        {
+            model_entry_t *m = model_table[j]; model_table[j] = model_table[j-1]; model_table[j-1] = m;
+            uint32_t c = cost[j]; cost[j] = cost[j-1]; cost[j-1] = c;
+        }
+    }
+
+    cur_model = 0;
+    up_cnt = 0;
+    reset_pending = 1;
+    switch_cnt = 0;
+    return 0;
+}
+
+void model_set_destruct(struct pi_device *cluster)
+{
+    pi_l1_free(cluster, l1_arena, l1_arena_size);
+    if (l2_arena_size > 0) pi_l2_free(l2_arena, l2_arena_size);
+    for (int i = 0; i < num_models; i++)
+    {
+        // the destructor frees the L1 and the dynamic L2 of its own graph
+        if (model_table[i]->l1_size > 0)
+            *model_table[i]->l1_memory = pi_l1_malloc(cluster, model_table[i]->l1_size);
+        if (model_table[i]->l2_dyn_size > 0)
+            *model_table[i]->l2_memory = pi_l2_malloc(model_table[i]->l2_dyn_size);
+        model_table[i]->destruct();
+    }
+}
+
+void model_set_run(void *io, int reset)
+{
+    model_table[cur_model]->run(io, reset | reset_pending);
+    reset_pending = 0;
+}
+
+void model_set_update(uint32_t nn_us, uint32_t budget_us)
+{
+    uint32_t mhz = cl_mhz();
+    cost[cur_model] = (3 * cost[cur_model] + nn_us * mhz) / 4;
+    residency[cur_model]++;
+
+    if (pinned_model >= 0)
+    {
+        set_model(pinned_model);
+        return;
+    }
+
+    uint32_t budget = budget_us * mhz;
+    if (cap_cycles > 0 && cap_cycles < budget) budget = cap_cycles;
+
+    // the active model does not fit: the best one that does (the lightest if none)
+    if (cost[cur_model] > budget)
+    {
+        int m = num_models - 1;
+        for (int i = num_models - 1; i > cur_model; i--)
+        {
+            if (cost[i] <= budget) m = i;
+        }
+        set_model(m);
+        return;
+    }
+
+    if (cur_model > 0 && cost[cur_model-1] * 100 <= budget * MODEL_UP_THRESHOLD)
+    {
+        if (++up_cnt >= MODEL_UP_HOPS) set_model(cur_model - 1);
+    }
+    else
+    {
+        up_cnt = 0;
+    }
+}
+
+void model_set_cap(uint32_t cycles)
+{
+    cap_cycles = cycles;
+}
+
+int model_set_pin(const char *name)
+{
+    if (name == NULL)
+    {
+        pinned_model = -1;
+        return 0;
+    }
+    // the models are ranked at the construction: the index of a name does not change afterwards
+    for (int i = 0; i < num_models; i++)
+    {
+        if (strcmp(model_table[i]->name, name) == 0)
+        {
+            pinned_model = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *model_set_active(void)
+{
+    return model_table[cur_model]->name;
+}
+
+uint32_t model_set_l2_size(void)
+{
+    uint32_t size = l2_arena_size;
+    for (int i = 0; i < num_models; i++) size += model_table[i]->l2_size;
+    return size;
+}
+
+void model_set_print(void)
+{
+    printf("Models: %d switches, L1 arena %d bytes, L2 arena %d bytes\n", switch_cnt, l1_arena_size, l2_arena_size);
+    for (int i = 0; i < num_models; i++)
+    {
+        printf("%20s: %10d cycles/hop, L2 %7d bytes, states %4d, %8d hops%s\n", model_table[i]->name,
+            cost[i], model_table[i]->l2_size, model_table[i]->state_len, residency[i],
+            (i == cur_model) ? " (active)" : "");
+    }
+}
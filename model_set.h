@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+
+
+/*
+ * Runtime model switching (MODEL_SET)
+ *
+ * Several denoiser graphs are constructed at startup and linked in the same
+ * image: the main model selected by DEMO/GRU plus the extra ones listed in
+ * MODEL_SET. Every graph keeps its own RNN states (of its own length) and
+ * the static part of its L2 area, where the constants promoted to L2 are
+ * loaded at the construction. The L1 and the dynamic part of the L2 are only
+ * scratch areas of the generated kernels, live within a call of the graph:
+ * a single arena of each, as large as the biggest graph needs, is shared by
+ * all of them.
+ *
+ * The models are ranked by their cost, measured at the startup, assuming that
+ * the heavier ones give the better masks. At every hop the governor keeps the
+ * best model whose cost fits the budget: it steps down as soon as the active
+ * one does not fit anymore and steps up only after MODEL_UP_HOPS consecutive
+ * hops in which the better model would fit with margin. The states of the
+ * incoming model are reset at the switch: the hidden states of different
+ * networks are not interchangeable.
+ */
+#ifndef MODEL_SET_MAX
+#define MODEL_SET_MAX       (3)
+#endif
+
+/*
+ * \brief a constructed graph, defined by <prefix>_entry.c (see model_entry.h)
+ */
+typedef struct {
+    const char *name;
+    int (*construct)(void);
+    int (*destruct)(void);
+    void (*run)(void *io, int reset);   // in-place inference, cluster side
+    void **l1_memory;                   // L1 base of the generated kernels
+    uint32_t l1_size;                   // 0 if the model does not use the shared L1
+    void **l2_memory;                   // dynamic L2 base of the generated kernels
+    uint32_t l2_dyn_size;               // 0 if the model does not use the shared L2
+    uint32_t l2_size;                   // L2 kept by the model (static part)
+    uint32_t state_len;                 // length of the RNN states, 0 if none
+} model_entry_t;
+
+/*
+ * \brief add a model to the set, before model_set_construct
+ */
+void model_set_add(model_entry_t *m);
+
+/*
+ * \brief construct all the graphs, share the L1 and the dynamic L2 and measure the cost of every model on io
+ *
+ * io is the NN input/output buffer: it is overwritten by the measurement.
+ * Returns the error of the first constructor failing, 0 otherwise.
+ */
+int model_set_construct(struct pi_device *cluster, void *io);
+
+/*
+ * \brief destruct all the graphs
+ */
+void model_set_destruct(struct pi_device *cluster);
+
+/*
+ * \brief run the active model (cluster side), reset is forced at the first hop after a switch
+ */
+void model_set_run(void *io, int reset);
+
+/*
+ * \brief update the governor with the NN time of the last hop
+ *
+ * budget_us is the time left to the NN within the hop. The cost of the models
+ * is kept in cluster cycles, so that the choice follows the cluster frequency
+ * (e.g. with DVFS).
+ */
+void model_set_update(uint32_t nn_us, uint32_t budget_us);
+
+/*
+ * \brief cap the NN cycles per hop (e.g. from the battery level), 0 to remove the cap
+ */
+void model_set_cap(uint32_t cycles);
+
+/*
+ * \brief run the model name (e.g. "denoiser_GRU") whatever the budget, NULL to return to the governor
+ *
+ * Returns 0 if successful, -1 if no model of the set has this name (the previous choice is kept).
+ */
+int model_set_pin(const char *name);
+
+/*
+ * \brief name of the active model
+ */
+const char *model_set_active(void);
+
+/*
+ * \brief L2 of all the graphs of the set, the shared dynamic L2 included
+ */
+uint32_t model_set_l2_size(void);
+
+/*
+ * \brief print the cost of the models and the number of hops run by each of them
+ */
+void model_set_print(void);
@@ -0,0 +1,58 @@
+# Runtime model switching (MODEL_SET)
+#------------------------------------------
+# Every extra model is generated by a nested make in its own build directory,
+# with the same quantization and memory settings of the main one but a smaller
+# L2 area (MODEL_SET_L2_MEMORY), then the global symbols of its graph are
+# prefixed (model/prefix_kernels.py) so that all the graphs link together.
+# The RNN states of an extra model are MODEL_SET_H_STATE_LEN_<model> long
+# (default 256), the ones of the main model H_STATE_LEN.
+MODEL_SET_L2_MEMORY?=150000
+
+model_set_state_len = $(or $(MODEL_SET_H_STATE_LEN_$(1)),256)
+model_set_build = BUILD_MODEL_SET_$(1)_h$(call model_set_state_len,$(1))$(MODEL_SUFFIX)
+model_set_expressions = $(addprefix $(call model_set_build,$(1))/,$(notdir $(MODEL_EXPRESSIONS)))
+model_set_demo = $(if $(filter denoiser_dns,$(1)),1,0)
+model_set_gru = $(if $(filter denoiser,$(1)),0,1)
+
+define MODEL_SET_RULES
+$(call model_set_build,$(1))/$(1)Kernels.c:
+	$$(MAKE) --no-print-directory model MODEL_SET= DEMO=$(call model_set_demo,$(1)) GRU=$(call model_set_gru,$(1)) \
+		MODEL_BUILD=$(call model_set_build,$(1)) MODEL_L2_MEMORY=$(MODEL_SET_L2_MEMORY) \
+		H_STATE_LEN=$(call model_set_state_len,$(1))
+	python $(TRAINED_MODEL_PATH)/prefix_kernels.py --prefix $(1) $(call model_set_build,$(1))
+
+# generated (and prefixed) with the kernels of the graph
+$(call model_set_expressions,$(1)): $(call model_set_build,$(1))/$(1)Kernels.c ;
+
+APP_SRCS += $(call model_set_build,$(1))/$(1)Kernels.c $(call model_set_expressions,$(1)) $(1)_entry.c
+APP_CFLAGS += -I$(call model_set_build,$(1)) -DMODEL_SET_$(1) -D$(1)_STATE_LEN=$(call model_set_state_len,$(1))
+READFS_FILES += $(abspath $(call model_set_build,$(1))/$(1)_L3_Flash_Const.dat)
+endef
+
+ifneq ($(filter $(MODEL_PREFIX),$(MODEL_SET)),)
+    $(error $(MODEL_PREFIX) is the main model: MODEL_SET lists the extra ones)
+endif
+ifneq ($(IS_INPUT_STFT), 0)
+    $(error MODEL_SET is supported in APP_MODE 0 and 1 only)
+endif
+
+# the classical suppression engine (wiener.c) can be a member of the set as well
+MODEL_SET_NN = $(filter-out wiener,$(MODEL_SET))
+$(foreach m,$(MODEL_SET_NN),$(eval $(call MODEL_SET_RULES,$(m))))
+ifneq ($(filter wiener,$(MODEL_SET)),)
+	APP_SRCS += wiener.c
+	APP_CFLAGS += -DMODEL_SET_wiener
+endif
+
+APP_SRCS += model_set.c $(MODEL_PREFIX)_entry.c
+APP_CFLAGS += -DMODEL_SET -D$(MODEL_PREFIX)_STATE_LEN=$(H_STATE_LEN)
+APP_CFLAGS += -DMODEL_BUDGET_PCT=$(MODEL_BUDGET_PCT) -DMODEL_CYCLES_CAP=$(MODEL_CYCLES_CAP)
+
+model_set: $(foreach m,$(MODEL_SET_NN),$(call model_set_build,$(m))/$(m)Kernels.c)
+
+clean_model_set:
+	rm -rf $(foreach m,$(MODEL_SET_NN),$(call model_set_build,$(m)))
+
+.PHONY: model_set clean_model_set
+
+all:: | model_set
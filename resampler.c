@@ -0,0 +1,121 @@
+#include "resampler.h"
+
+#include "pmsis.h"
+#include <math.h>
+
+#define RESAMPLER_PI (3.14159265358979f)
+
+typedef struct {
+    resampler_t *rs;
+    int n_in;
+    short *out;
+    int n_out;
+} resampler_arg_t;
+
+
+int resampler_init(resampler_t *rs, int fs_in, int fs_out, int max_in, void *mem)
+{
+    int L, M, K;
+    resampler_geometry(fs_in, fs_out, &L, &M, &K);
+    int max_lm = (L > M) ? L : M;
+
+    // the first call also fills the filter delay: up to K/2 input samples more than the next ones
+    max_in += K;
+
+    rs->up = L;
+    rs->down = M;
+    rs->taps = K;
+    rs->max_in = max_in;
+
+    if (mem == NULL) return -1;
+    // coefficients, history and new samples, in the layout of resampler_mem_size
+    rs->coeffs = (float *) mem;
+    rs->hist = rs->coeffs + L * K;
+    rs->in = (short *) (rs->hist + K + max_in);
+
+    // low-pass prototype at the upsampled rate fs_in*L: cutoff at the lower Nyquist
+    // frequency, gain L to compensate the zero insertion, blackman window
+    int N = L * K;
+    int center = N / 2;
+    float fc = 0.5f / max_lm;
+    for (int n = 0; n < N; n++) {
+        float x = (float) (n - center);
+        float sinc = (n == center) ? 1.0f : sinf(2.0f * RESAMPLER_PI * fc * x) / (2.0f * RESAMPLER_PI * fc * x);
+        float w = 0.42f + 0.5f * cosf(2.0f * RESAMPLER_PI * x / N) + 0.08f * cosf(4.0f * RESAMPLER_PI * x / N);
+        // h[ph + k*L] is stored at ph*K + k
+        rs->coeffs[(n % L) * K + (n / L)] = L * 2.0f * fc * sinc * w;
+    }
+
+    for (int i = 0; i < K + max_in; i++) rs->hist[i] = 0.0f;
+
+    // the first output is aligned to the first input sample, compensating the filter delay
+    rs->pos = K * L + center;
+    return 0;
+}
+
+int resampler_in_needed(resampler_t *rs, int n_out)
+{
+    // the last output reads up to the history sample (pos + (n_out-1)*M) / L
+    int last = (rs->pos + (n_out - 1) * rs->down) / rs->up;
+    int n_in = last + 1 - rs->taps;
+    return (n_in > 0) ? n_in : 0;
+}
+
+int resampler_out_avail(resampler_t *rs, int n_in)
+{
+    int end = (rs->taps + n_in) * rs->up;
+    if (rs->pos >= end) return 0;
+    return (end - 1 - rs->pos) / rs->down + 1;
+}
+
+int resampler_max_out(resampler_t *rs)
+{
+    // after the first call the next output is always within the last L positions of the history
+    return (rs->max_in * rs->up - 1) / rs->down + 1;
+}
+
+static void resampler_core(void *arg)
+{
+    resampler_t *rs = ((resampler_arg_t *) arg)->rs;
+    int n_in = ((resampler_arg_t *) arg)->n_in;
+    short *out = ((resampler_arg_t *) arg)->out;
+    int n_out = ((resampler_arg_t *) arg)->n_out;
+    int K = rs->taps;
+    float *x = rs->hist;
+    int core = pi_core_id(), nc = pi_cl_team_nb_cores();
+    int chunk, first, last;
+
+    // Q15 to float, appended after the history
+    chunk = (n_in + nc - 1) / nc;
+    first = core * chunk;
+    last = (first + chunk < n_in) ? (first + chunk) : n_in;
+    for (int i = first; i < last; i++) x[K + i] = (float) rs->in[i];
+    pi_cl_team_barrier();
+
+    // the outputs are independent: every core computes its own range
+    chunk = (n_out + nc - 1) / nc;
+    first = core * chunk;
+    last = (first + chunk < n_out) ? (first + chunk) : n_out;
+    for (int j = first; j < last; j++) {
+        int t = rs->pos + j * rs->down;
+        int b = t / rs->up;
+        float *c = rs->coeffs + (t % rs->up) * K;
+        float acc = 0.0f;
+        for (int k = 0; k < K; k++) acc += c[k] * x[b - k];
+        int v = (int) (acc + ((acc >= 0.0f) ? 0.5f : -0.5f));
+        out[j] = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
+    }
+    pi_cl_team_barrier();
+
+    // keep the last K samples as history of the next call
+    if (core == 0) {
+        for (int i = 0; i < K; i++) x[i] = x[n_in + i];
+    }
+}
+
+void resampler_run(resampler_t *rs, int n_in, short *out, int n_out)
+{
+    resampler_arg_t arg = { rs, n_in, out, n_out };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), resampler_core, &arg);
+    rs->pos += n_out * rs->down - n_in * rs->up;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+
+
+/*
+ * \brief streaming polyphase resampler from fs_in to fs_out (ratio L/M)
+ *
+ * The input samples are kept in a history buffer of K samples (taps per phase)
+ * followed by the new samples of the current call. pos is the position of the
+ * next output sample in the L-times upsampled domain, counted from the start of
+ * the history buffer.
+ */
+typedef struct {
+    int up;         // L
+    int down;       // M
+    int taps;       // K, taps per phase
+    int max_in;     // max number of new input samples per call
+    int pos;        // position of the next output, in 1/L input samples
+    float *coeffs;  // L*K polyphase coefficients, phase major
+    float *hist;    // K history samples + max_in new samples
+    short *in;      // new input samples of the next call
+} resampler_t;
+
+// zero crossings of the sinc on each side, at the lower of the two rates
+#ifndef RESAMPLER_ZERO_CROSSINGS
+#define RESAMPLER_ZERO_CROSSINGS (16)
+#endif
+
+static inline int resampler_gcd(int a, int b)
+{
+    while (b) { int t = a % b; a = b; b = t; }
+    return a;
+}
+
+/*
+ * \brief ratio L/M and taps per phase K of the filter from fs_in to fs_out
+ */
+static inline void resampler_geometry(int fs_in, int fs_out, int *L, int *M, int *K)
+{
+    int g = resampler_gcd(fs_in, fs_out);
+    *L = fs_out / g;
+    *M = fs_in / g;
+    int max_lm = (*L > *M) ? *L : *M;
+    *K = (2 * RESAMPLER_ZERO_CROSSINGS * max_lm + *L - 1) / *L;
+    *K += *K & 1; // even number of taps: the filter delay K*L/2 is an integer number of samples
+}
+
+/*
+ * \brief group delay of the filter from fs_in to fs_out in us, 0 if fs_in == fs_out
+ *
+ * K*L/2 samples of the L-times upsampled domain: the look-ahead of the first
+ * call, i.e. the latency the resampler adds to a real-time stream.
+ */
+static inline uint32_t resampler_delay_us(int fs_in, int fs_out)
+{
+    int L, M, K;
+    if (fs_in == fs_out) return 0;
+    resampler_geometry(fs_in, fs_out, &L, &M, &K);
+    return (uint32_t) (((uint64_t) K * 1000000) / (2 * fs_in));
+}
+
+/*
+ * \brief bytes of the buffers of a resampler (mem of resampler_init), 0 if fs_in == fs_out
+ *
+ * Depends on the arguments only, so that the buffers can be planned at build
+ * time (l2_plan.h).
+ */
+static inline uint32_t resampler_mem_size(int fs_in, int fs_out, int max_in)
+{
+    int L, M, K;
+    if (fs_in == fs_out) return 0;
+    resampler_geometry(fs_in, fs_out, &L, &M, &K);
+    max_in += K;
+    return (L * K + K + max_in) * sizeof(float) + ((max_in * sizeof(short) + 7) & ~7);
+}
+
+/*
+ * \brief upper bound of the output samples of a call (see resampler_max_out), 0 if fs_in == fs_out
+ */
+static inline int resampler_max_out_size(int fs_in, int fs_out, int max_in)
+{
+    int L, M, K;
+    if (fs_in == fs_out) return 0;
+    resampler_geometry(fs_in, fs_out, &L, &M, &K);
+    return ((max_in + K) * L - 1) / M + 1;
+}
+
+/*
+ * \brief compute the polyphase filter (windowed sinc) in the buffers at mem
+ *
+ * max_in is the max number of new input samples per call: the buffers are
+ * enlarged by K samples for the first call, which also fills the filter delay.
+ * mem holds resampler_mem_size(fs_in, fs_out, max_in) bytes, 4 bytes aligned,
+ * and is owned by the caller.
+ *
+ * \return 0 if successful, an error code otherwise
+ */
+int resampler_init(resampler_t *rs, int fs_in, int fs_out, int max_in, void *mem);
+
+/*
+ * \brief number of new input samples to write in rs->in to produce n_out samples
+ */
+int resampler_in_needed(resampler_t *rs, int n_out);
+
+/*
+ * \brief number of output samples that n_in new input samples complete
+ */
+int resampler_out_avail(resampler_t *rs, int n_in);
+
+/*
+ * \brief upper bound of the output samples of a call, to size the output buffer
+ */
+int resampler_max_out(resampler_t *rs);
+
+/*
+ * \brief consume the n_in samples of rs->in and produce n_out samples, to be called from the cluster master core
+ *
+ * The outputs are split among the cores of the cluster. n_out must not exceed
+ * resampler_out_avail(rs, n_in), and n_in must not exceed max_in.
+ */
+void resampler_run(resampler_t *rs, int n_in, short *out, int n_out);
@@ -1,11 +1,25 @@
 # User Test
 #------------------------------------------
-FFT_BUILD_DIR ?= $(CURDIR)/BUILD_MODEL_STFT
+# the generated kernels and tables depend on the framing and the datatype: one directory per
+# configuration, so that LOW_LATENCY, NARROWBAND or BFP16 never reuse stale files
+FFT_BUILD_DIR ?= $(CURDIR)/BUILD_MODEL_STFT_$(FRAME_SIZE)_$(FRAME_STEP)_$(FRAME_NFFT)_$(STFT_DATATYPE)
 FFT_MODEL_GEN = $(FFT_BUILD_DIR)/GenSTFT
 FFT_SRCG += $(TILER_DSP_GENERATOR_PATH)/DSP_Generators.c
-WIN_LUT = $(FFT_BUILD_DIR)/WinLUT_f16.def
+ifeq '$(QUANT_BITS)' 'BFP16'
+	STFT_DATATYPE = BFLOAT16
+	WIN_LUT_DTYPE = bfloat16
+	WIN_LUT = $(FFT_BUILD_DIR)/WinLUT_bf16.def
+else
+	STFT_DATATYPE = FLOAT16
+	WIN_LUT_DTYPE = float16
+	WIN_LUT = $(FFT_BUILD_DIR)/WinLUT_f16.def
+endif
 
 FFT_GEN_SRC = $(FFT_BUILD_DIR)/RFFTKernels.c
+BAND_LUT = $(FFT_BUILD_DIR)/BandLUT.def
+MIXED_FFT_LUT = $(FFT_BUILD_DIR)/MixedFFTLUT.def
+# configuration of the generated files, checked by denoiser.c
+STFT_CONFIG = $(FFT_BUILD_DIR)/STFTConfig.h
 
 
 FRAME_SIZE?=400
@@ -37,21 +51,40 @@ endif
 
 
 $(FFT_BUILD_DIR):
-	mkdir $(FFT_BUILD_DIR)
+	mkdir -p $(FFT_BUILD_DIR)
+
+$(STFT_CONFIG): | $(FFT_BUILD_DIR)
+	printf '#pragma once\n#define STFT_CFG_FRAME_SIZE %d\n#define STFT_CFG_FRAME_STEP %d\n#define STFT_CFG_NFFT %d\n#define STFT_CFG_%s\n' \
+		$(FRAME_SIZE) $(FRAME_STEP) $(FRAME_NFFT) $(STFT_DATATYPE) > $@
 
 $(WIN_LUT): | $(FFT_BUILD_DIR)
-	python $(TILER_MFCC_GEN_LUT_SCRIPT) --fft_lut_file $(WIN_LUT) --win_func "hanning" --dtype "float16" --frame_size $(FRAME_SIZE) --frame_step $(FRAME_STEP) --n_fft $(FRAME_NFFT) --gen_inv
+	python $(TILER_MFCC_GEN_LUT_SCRIPT) --fft_lut_file $(WIN_LUT) --win_func "hanning" --dtype "$(WIN_LUT_DTYPE)" --frame_size $(FRAME_SIZE) --frame_step $(FRAME_STEP) --n_fft $(FRAME_NFFT) --gen_inv
+
+# tables of the mixed-radix FFT (mixed_fft.c), used in place of the generated STFT/iSTFT
+$(MIXED_FFT_LUT): | $(FFT_BUILD_DIR)
+	python $(TRAINED_MODEL_PATH)/gen_mixed_fft_lut.py --fft_lut_file $(MIXED_FFT_LUT) --frame_size $(FRAME_SIZE) --n_fft $(FRAME_NFFT)
+
+$(BAND_LUT): | $(FFT_BUILD_DIR)
+	python $(TRAINED_MODEL_PATH)/gen_band_lut.py --band_lut_file $(BAND_LUT) --n_fft $(FRAME_NFFT) --num_bands $(NUM_BANDS) --sample_rate $(SAMPLING_FREQ) --band_scale $(BAND_SCALE)
 
 # Build the code generator from the model code
 $(FFT_MODEL_GEN): | $(FFT_BUILD_DIR)
-	gcc -g -o $(FFT_MODEL_GEN) -I. -I$(TILER_DSP_GENERATOR_PATH) -I$(TILER_INC) -I$(TILER_EMU_INC) $(TRAINED_MODEL_PATH)/STFTModel.c $(FFT_SRCG) $(TILER_LIB) $(GEN_FLAG) $(SDL_FLAGS) -DFRAME_SIZE=$(FRAME_SIZE) -DFRAME_STEP=$(FRAME_STEP) -DN_FFT=$(FRAME_NFFT)
+	gcc -g -o $(FFT_MODEL_GEN) -I. -I$(TILER_DSP_GENERATOR_PATH) -I$(TILER_INC) -I$(TILER_EMU_INC) $(TRAINED_MODEL_PATH)/STFTModel.c $(FFT_SRCG) $(TILER_LIB) $(GEN_FLAG) $(SDL_FLAGS) -DFRAME_SIZE=$(FRAME_SIZE) -DFRAME_STEP=$(FRAME_STEP) -DN_FFT=$(FRAME_NFFT) -DSTFT_DATATYPE=$(STFT_DATATYPE)
 
 
 # Run the code generator  kernel code
 $(FFT_GEN_SRC): $(FFT_MODEL_GEN) $(WIN_LUT) | $(FFT_BUILD_DIR)
 	$(FFT_MODEL_GEN) -o $(FFT_BUILD_DIR) -c $(FFT_BUILD_DIR) $(MODEL_GEN_EXTRA_FLAGS)
 
+gen_fft_code: $(STFT_CONFIG)
+ifeq ($(FFT_MIXED_RADIX), 1)
+gen_fft_code: $(MIXED_FFT_LUT)
+else
 gen_fft_code: $(FFT_GEN_SRC)
+endif
+ifneq ($(NUM_BANDS), 0)
+gen_fft_code: $(BAND_LUT)
+endif
 
 clean_fft_code:
 	rm -rf $(FFT_BUILD_DIR)
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+
+/*
+ * Packed STFT container, input of the NN tests (IS_INPUT_STFT=1)
+ *
+ * A header followed by num_frames contiguous frames of num_bins magnitudes,
+ * stored as float32 or float16 (little endian). The file is written by
+ * test_accuracy/pack_stft.py.
+ */
+#define STFT_PACK_MAGIC     (0x54465453)    // "STFT"
+#define STFT_PACK_VERSION   (1)
+#define STFT_PACK_FLOAT32   (0)
+#define STFT_PACK_FLOAT16   (1)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t dtype;         // STFT_PACK_FLOAT32 or STFT_PACK_FLOAT16
+    uint32_t num_frames;
+    uint32_t num_bins;      // values per frame
+} stft_pack_header_t;
+
+/*
+ * \brief bytes of a frame of the container, 0 if the dtype is unknown
+ */
+static inline uint32_t stft_pack_frame_bytes(stft_pack_header_t *header)
+{
+    if (header->dtype == STFT_PACK_FLOAT16) return header->num_bins * 2;
+    if (header->dtype == STFT_PACK_FLOAT32) return header->num_bins * 4;
+    return 0;
+}
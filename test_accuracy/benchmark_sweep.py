@@ -0,0 +1,263 @@
+import os
+import re
+import sys
+import argparse
+import itertools
+import subprocess
+import numpy as np
+import soundfile as sf
+import librosa
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from test_GAP import _run_metrics
+
+# Benchmark driver for the model size / quantization trade-off
+# Every configuration is built once, then run on gvsoc (APP_MODE=1) over a fixed
+# set of utterances to collect cycles per hop, memory footprint, PESQ and STOI.
+
+GVSOC_OUTPUT = 'BUILD/GAP9_V2/GCC_RISCV_FREERTOS/test_gap.wav'
+INPUT_FILE = os.getcwd() + '/samples/test_bench.wav'
+
+def make_args(cfg):
+    args  = " platform=gvsoc APP_MODE=1 DEMO=0 SILENT=1 CHECKSUM=0"
+    args += " GRU=" + str(cfg['gru'])
+    args += " QUANT_BITS=" + cfg['quant']
+    args += " H_STATE_LEN=" + str(cfg['h_state_len'])
+    if cfg['onnx']:
+        args += " TRAINED_MODEL=" + cfg['onnx']
+    if cfg.get('script'):
+        args += " NNTOOL_SCRIPT=" + cfg['script']
+    if cfg.get('wiener'):
+        args += " WIENER=1"
+    args += " WAV_FILE=" + INPUT_FILE
+    return args
+
+def run_make(targets, cfg):
+    command = "make " + targets + make_args(cfg)
+    print("Going to run: ", command)
+    res = subprocess.run(command, shell=True, stdout=subprocess.PIPE,
+                         stderr=subprocess.STDOUT, universal_newlines=True)
+    if res.returncode != 0:
+        print(res.stdout[-4000:])
+        return None
+    return res.stdout
+
+def parse_cycles(log):
+    # parse the per frame averages printed at the end of the run
+    cycles = {}
+    section = log.split("Average cycles per frame")
+    if len(section) < 2:
+        return None
+    for line in section[-1].splitlines():
+        m = re.match(r"\s*(.+?):\s+Cycles:\s+(\d+)", line)
+        if m:
+            cycles[m.group(1).strip()] = int(m.group(2))
+    return cycles
+
+def model_info(cfg):
+    # build directory and prefix as resolved by the Makefile for the whole configuration
+    # (MODEL_VARIANT, MODEL_COMPRESS, ...), so that the footprints are never mislabeled
+    log = run_make("-s model_info", cfg)
+    m = re.search(r"MODEL_BUILD=(\S+) MODEL_PREFIX=(\S+)", log) if log else None
+    return (m.group(1), m.group(2)) if m else (None, None)
+
+def parse_footprint(cfg):
+    # L1/L2 from the generated model header, L3 from the flash tensors file
+    footprint = {'L1': 0, 'L2': 0, 'L3': 0}
+    if cfg.get('wiener'):
+        # no graph: the state of the engine is in the application L2
+        return footprint
+    model_build, prefix = model_info(cfg)
+    if model_build is None:
+        print("Error! model build directory not resolved for ", cfg)
+        return None
+    header = os.path.join(model_build, prefix + 'Kernels.h')
+    if os.path.isfile(header):
+        with open(header) as fp:
+            for line in fp:
+                m = re.match(r"#define\s+_" + prefix + r"_(L1|L2)_Memory_SIZE\s+(\d+)", line)
+                if m:
+                    footprint[m.group(1)] = int(m.group(2))
+    tensors = os.path.join(model_build, prefix + '_L3_Flash_Const.dat')
+    if os.path.isfile(tensors):
+        footprint['L3'] = os.path.getsize(tensors)
+    return footprint
+
+def bench_config(cfg, filenames, noisy_path, clean_path, samplerate, padding):
+    if run_make("clean all", cfg) is None:
+        return None
+
+    result = parse_footprint(cfg)
+    if result is None:
+        return None
+    hop_cycles = []
+    metrics = []
+    for file in filenames:
+        data, s = librosa.load(noisy_path + file + '.wav', sr=samplerate)
+        if padding:
+            data = np.pad(data, (padding, padding))
+        sf.write(INPUT_FILE, data, samplerate)
+
+        if os.path.isfile(GVSOC_OUTPUT):
+            os.remove(GVSOC_OUTPUT)
+        log = run_make("all run", cfg)
+        if log is None or not os.path.isfile(GVSOC_OUTPUT):
+            print("Error! no output produced for ", file)
+            return None
+
+        cycles = parse_cycles(log)
+        if cycles:
+            hop_cycles.append(sum(v for k, v in cycles.items() if k in ['STFT', 'iSTFT', 'Total NN', 'Wiener']))
+
+        estimate, s = librosa.load(GVSOC_OUTPUT, sr=samplerate)
+        estimate = estimate[padding:]
+        clean_data, s = librosa.load(clean_path + file + '.wav', sr=samplerate)
+        sz0 = clean_data.shape[0]
+        sz1 = estimate.shape[0]
+        if sz0 > sz1:
+            estimate = np.pad(estimate, (0,sz0-sz1))
+        else:
+            estimate = estimate[:sz0]
+
+        pesq_i, stoi_i = _run_metrics(clean_data, estimate, samplerate)
+        print("Sample ", file, "\twith pesq=\t", pesq_i, "\tand stoi=\t", stoi_i)
+        metrics.append([pesq_i, stoi_i])
+
+    result['cycles'] = int(np.mean(hop_cycles)) if hop_cycles else 0
+    result['pesq'] = float(np.mean([m[0] for m in metrics]))
+    result['stoi'] = float(np.mean([m[1] for m in metrics]))
+    return result
+
+def pareto_front(results):
+    # a configuration is on the front if no other one is at least as good on
+    # cycles, L3 footprint, PESQ and STOI and strictly better on one of them
+    def dominates(a, b):
+        no_worse = a['cycles'] <= b['cycles'] and a['L3'] <= b['L3'] and \
+                   a['pesq'] >= b['pesq'] and a['stoi'] >= b['stoi']
+        better = a['cycles'] < b['cycles'] or a['L3'] < b['L3'] or \
+                 a['pesq'] > b['pesq'] or a['stoi'] > b['stoi']
+        return no_worse and better
+    for r in results:
+        r['pareto'] = not any(dominates(o, r) for o in results if o is not r)
+
+def print_speedup(results, baseline):
+    # every quantization against the baseline one (same model and state)
+    def key(cfg):
+        return (cfg['gru'], cfg['h_state_len'], cfg['onnx'])
+    base = {key(r['cfg']): r for r in results if r['cfg']['quant'] == baseline and not r['cfg'].get('wiener')}
+    others = [r for r in results if r['cfg']['quant'] != baseline and not r['cfg'].get('wiener')]
+    if not base or not others:
+        return
+    print('\nAgainst QUANT_BITS={}:'.format(baseline))
+    for r in others:
+        b = base.get(key(r['cfg']))
+        if b is None or r['cycles'] == 0:
+            continue
+        cfg = r['cfg']
+        print('{} {} h={}: cycles/hop {} vs {} (x{:.2f}), PESQ {:+.3f}, STOI {:+.3f}'.format(
+            'GRU' if cfg['gru'] else 'LSTM', cfg['quant'], cfg['h_state_len'], r['cycles'], b['cycles'],
+            b['cycles'] / r['cycles'], r['pesq'] - b['pesq'], r['stoi'] - b['stoi']))
+
+def print_table(results, csv_file=None):
+    header = ['model', 'quant', 'h_state', 'cycles/hop', 'L1', 'L2', 'L3', 'PESQ', 'STOI', 'pareto']
+    rows = []
+    for r in sorted(results, key=lambda x: x['cycles']):
+        cfg = r['cfg']
+        if cfg.get('wiener'):
+            model = 'Wiener'
+        else:
+            model = os.path.basename(cfg['onnx']) if cfg['onnx'] else ('GRU' if cfg['gru'] else 'LSTM')
+        rows.append([model, cfg['quant'], str(cfg['h_state_len']), str(r['cycles']),
+                     str(r['L1']), str(r['L2']), str(r['L3']), '%.3f' % r['pesq'],
+                     '%.3f' % r['stoi'], '*' if r['pareto'] else ''])
+    widths = [max(len(x) for x in col) for col in zip(header, *rows)]
+    print(' | '.join(h.ljust(w) for h, w in zip(header, widths)))
+    print('-+-'.join('-' * w for w in widths))
+    for row in rows:
+        print(' | '.join(c.ljust(w) for c, w in zip(row, widths)))
+
+    if csv_file:
+        with open(csv_file, 'w') as fp:
+            fp.write(','.join(header) + '\n')
+            for row in rows:
+                fp.write(','.join(row) + '\n')
+        print("Results stored in: ", csv_file)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'GAP denoiser benchmark', description="Cycles, memory and accuracy sweep of the TinyDenoiser configurations on gvsoc")
+
+    parser.add_argument('--gru', type=str, default="0,1",
+                        help="Comma separated list of GRU settings (0: LSTM, 1: GRU)")
+    parser.add_argument('--quant', type=str, default="FP16,FP16MIXED,8",
+                        help="Comma separated list of QUANT_BITS settings")
+    parser.add_argument('--baseline', type=str, default="FP16MIXED",
+                        help="QUANT_BITS setting the others are compared with (speedup and PESQ/STOI difference)")
+    parser.add_argument('--h_state_len', type=str, default="256",
+                        help="Comma separated list of H_STATE_LEN settings")
+    parser.add_argument('--onnx_pattern', type=str, default="",
+                        help="Onnx file of the models with H_STATE_LEN != 256, e.g. model/{prefix}_h{h}.onnx")
+
+    parser.add_argument('--wiener', action="store_true",
+                        help="Add the classical spectral suppression engine (WIENER=1) as a baseline")
+
+    parser.add_argument("--noisy_dataset_path", type=str, default="samples/dataset/noisy/",
+                        help="Path of the noisy utterances")
+    parser.add_argument("--clean_dataset_path", type=str, default="samples/dataset/clean/",
+                        help="Path of the clean utterances")
+    parser.add_argument('--num_samples', type=int, default=0,
+                        help="Number of utterances to use, 0 for all of them")
+    parser.add_argument('--sample_rate', default=16000, type=int, help='sample rate')
+    parser.add_argument('--pad_input', type=int, default=300,
+                        help="Pad the input left/right: computed as FRAME_SIZE - FRAME_HOP")
+    parser.add_argument("--csv", type=str, default="",
+                        help="Store the comparison table into a csv file")
+
+    args = parser.parse_args()
+
+    filenames = sorted([os.path.splitext(item)[0] for item in os.listdir(args.noisy_dataset_path)])
+    if args.num_samples > 0:
+        filenames = filenames[:args.num_samples]
+    if len(filenames) == 0:
+        print("Dataset is empty!")
+        exit(1)
+
+    results = []
+    for gru, quant, h in itertools.product(
+            [int(x) for x in args.gru.split(',')],
+            args.quant.split(','),
+            [int(x) for x in args.h_state_len.split(',')]):
+        prefix = 'denoiser_GRU' if gru else 'denoiser'
+        onnx = args.onnx_pattern.format(prefix=prefix, h=h) if (args.onnx_pattern and h != 256) else ''
+        if h != 256 and not os.path.isfile(onnx):
+            # the default models have 256 states: the code would not match the graph
+            print('Error! no onnx model with H_STATE_LEN={} (--onnx_pattern): configuration skipped'.format(h))
+            continue
+        cfg = {'gru': gru, 'quant': quant, 'h_state_len': h, 'onnx': onnx}
+        print('***** Benchmarking ', cfg, ' *****')
+        res = bench_config(cfg, filenames, args.noisy_dataset_path, args.clean_dataset_path,
+                           args.sample_rate, args.pad_input)
+        if res is None:
+            print('Configuration failed: ', cfg)
+            continue
+        res['cfg'] = cfg
+        results.append(res)
+
+    if args.wiener:
+        cfg = {'gru': 0, 'quant': 'FP16', 'h_state_len': 256, 'onnx': '', 'wiener': 1}
+        print('***** Benchmarking ', cfg, ' *****')
+        res = bench_config(cfg, filenames, args.noisy_dataset_path, args.clean_dataset_path,
+                           args.sample_rate, args.pad_input)
+        if res is None:
+            print('Configuration failed: ', cfg)
+        else:
+            res['cfg'] = cfg
+            results.append(res)
+
+    if len(results) == 0:
+        print("No configuration completed!")
+        exit(1)
+
+    pareto_front(results)
+    print_table(results, args.csv if args.csv else None)
+    print_speedup(results, args.baseline)
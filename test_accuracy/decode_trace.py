@@ -0,0 +1,104 @@
+# The script decodes the binary event trace of the application (TRACE=1, see trace.h)
+# into a timeline: the stage durations of every hop, the statistics of every stage
+# and the anomalies (late hops, clipping, stalls of the trace itself).
+#
+# Example:
+#   make clean all run platform=gvsoc APP_MODE=2 TRACE=1
+#   python test_accuracy/decode_trace.py trace.bin --timeline --chrome trace.json
+# trace.json can be opened with chrome://tracing or https://ui.perfetto.dev
+
+import argparse
+import json
+import struct
+import numpy as np
+
+TRACE_MAGIC = 0x45435254    # "TRCE"
+TRACE_VERSION = 1
+HEADER_FORMAT = '<IHHII'
+RECORD_DTYPE = np.dtype([('stamp', '<u4'), ('frame', '<u2'), ('event', 'u1'), ('flags', 'u1')])
+
+STAGES = ['hop', 'input', 'stft', 'nn', 'istft', 'output', 'flush']
+STOP_BIT = 0x80
+FLAGS = {1: 'deadline', 2: 'clipping', 4: 'overrun', 8: 'lost', 16: 'degraded'}
+
+
+def read_trace(filename):
+    with open(filename, 'rb') as fp:
+        magic, version, record_size, clock_hz, hop_us = struct.unpack(
+            HEADER_FORMAT, fp.read(struct.calcsize(HEADER_FORMAT)))
+        if magic != TRACE_MAGIC or version != TRACE_VERSION or record_size != RECORD_DTYPE.itemsize:
+            raise ValueError('{} is not a trace file'.format(filename))
+        data = fp.read()
+    records = np.frombuffer(data[:len(data) - len(data) % record_size], dtype=RECORD_DTYPE)
+    # the 32 bits timer and the 16 bits frame ids wrap on long runs
+    stamps = records['stamp'].astype(np.int64)
+    stamps += np.concatenate([[0], np.cumsum(np.diff(stamps) < 0)]) << 32
+    frames = records['frame'].astype(np.int64)
+    frames += np.concatenate([[0], np.cumsum(np.diff(frames) < 0)]) << 16
+    return clock_hz, hop_us, stamps * 1e6 / clock_hz, frames, records['event'], records['flags']
+
+def build_intervals(times_us, frames, events, flags):
+    # pairs every stop event with the last start event of the same stage
+    intervals, open_starts = [], {}
+    for t, frame, event, flag in zip(times_us, frames, events, flags):
+        stage = int(event) & (STOP_BIT - 1)
+        if event & STOP_BIT:
+            if stage in open_starts:
+                t0 = open_starts.pop(stage)
+                intervals.append((int(frame), STAGES[stage], t0, t - t0, int(flag)))
+        else:
+            open_starts[stage] = t
+    return intervals
+
+def flag_names(flag):
+    return ','.join(name for bit, name in FLAGS.items() if flag & bit)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'Trace decoder', description="Decode the binary event trace written with TRACE=1")
+    parser.add_argument('trace', type=str)
+    parser.add_argument('--timeline', action="store_true",
+                        help="Print the stage durations of every hop")
+    parser.add_argument('--chrome', type=str, default=None,
+                        help="Write the timeline in the Chrome trace event format")
+    args = parser.parse_args()
+
+    clock_hz, hop_us, times_us, frames, events, flags = read_trace(args.trace)
+    intervals = build_intervals(times_us, frames, events, flags)
+    print('{} events, {} intervals, stamps at {:.1f} MHz, hop period {} us'.format(
+        len(events), len(intervals), clock_hz / 1e6, hop_us))
+
+    if args.timeline:
+        print('{:>8s} {:>12s} '.format('frame', 'start [us]') + ' '.join('{:>9s}'.format(s) for s in STAGES[:-1]))
+        hops = {}
+        for frame, stage, t0, dur, flag in intervals:
+            hops.setdefault(frame, {})[stage] = (t0, dur, flag)
+        for frame in sorted(hops):
+            hop = hops[frame]
+            t0 = hop['hop'][0] if 'hop' in hop else min(v[0] for v in hop.values())
+            line = '{:8d} {:12.1f} '.format(frame, t0)
+            line += ' '.join('{:9.1f}'.format(hop[s][1]) if s in hop else '{:>9s}'.format('-') for s in STAGES[:-1])
+            if 'hop' in hop and hop['hop'][2]:
+                line += '  ' + flag_names(hop['hop'][2])
+            print(line)
+
+    print('{:>8s} {:>8s} {:>10s} {:>10s} {:>10s}'.format('stage', 'count', 'mean [us]', 'min [us]', 'max [us]'))
+    for stage in STAGES:
+        durs = np.array([dur for _, s, _, dur, _ in intervals if s == stage])
+        if len(durs) > 0:
+            print('{:>8s} {:8d} {:10.1f} {:10.1f} {:10.1f}'.format(stage, len(durs), durs.mean(), durs.min(), durs.max()))
+
+    anomalies = [(frame, stage, flag) for frame, stage, _, _, flag in intervals if flag]
+    for bit, name in FLAGS.items():
+        hit = [frame for frame, _, flag in anomalies if flag & bit]
+        if hit:
+            print('{}: {} times, first at frame {}'.format(name, len(hit), hit[0]))
+
+    if args.chrome:
+        trace_events = [{'name': stage, 'ph': 'X', 'ts': t0, 'dur': dur, 'pid': 0,
+            'tid': 0 if stage == 'hop' else 1, 'args': {'frame': frame, 'flags': flag_names(flag)}}
+            for frame, stage, t0, dur, flag in intervals]
+        with open(args.chrome, 'w') as fp:
+            json.dump({'traceEvents': trace_events}, fp)
+        print('Timeline written to: {}'.format(args.chrome))
@@ -0,0 +1,89 @@
+# The script generates the inputs and the goldens of the NN tests (APP_MODE 3):
+# the STFT magnitudes of the first frames of a wav file (mags.stft, see pack_stft.py)
+# and the floating point outputs of the LSTM and GRU models after STFT_FRAMES=1
+# and STFT_FRAMES=10 frames (golden_sample_0000.h).
+#
+# Example, narrowband goldens (NARROWBAND=1 looks for them in samples/narrowband/):
+#   python test_accuracy/gen_golden.py --narrowband --out_dir samples/narrowband \
+#       --model_onnx model/denoiser_nb.onnx --model_gru_onnx model/denoiser_GRU_nb.onnx
+
+import os
+import argparse
+import numpy as np
+import librosa
+import onnxruntime as ort
+
+from pack_stft import write_stft_pack
+
+
+def stft_mags(wav_file, sample_rate, win_len, win_inc, n_fft, num_frames):
+    data, _ = librosa.load(wav_file, sr=sample_rate)
+    stft = librosa.stft(data, n_fft=n_fft, hop_length=win_inc, win_length=win_len,
+        window='hann', center=False)
+    mags = np.abs(stft).T.astype(np.float32)
+    if mags.shape[0] < num_frames:
+        raise ValueError('{} has only {} frames'.format(wav_file, mags.shape[0]))
+    return mags[:num_frames]
+
+def run_model(model_onnx, mags, h_state_len):
+    # inputs: magnitudes followed by the RNN states, outputs: mask followed by the updated states
+    sess = ort.InferenceSession(model_onnx)
+    inputs = sess.get_inputs()
+    states = [np.zeros(h_state_len, dtype=np.float32) for _ in inputs[1:]]
+    masks = []
+    for frame in mags:
+        feed = {inputs[0].name: frame.reshape(inputs[0].shape)}
+        for inp, state in zip(inputs[1:], states):
+            feed[inp.name] = state.reshape(inp.shape)
+        outputs = sess.run(None, feed)
+        masks.append(outputs[0].reshape(-1))
+        states = [o.reshape(-1) for o in outputs[1:len(inputs)]]
+    return masks
+
+def _array(values):
+    return '{' + ','.join(repr(float(v)) for v in values) + '}'
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'Golden generator', description="Generate the STFT inputs and the NN goldens of APP_MODE 3")
+    parser.add_argument('--wav_input', type=str, default='samples/quant/p286_035.wav')
+    parser.add_argument('--out_dir', type=str, default='samples/narrowband')
+    parser.add_argument('--model_onnx', type=str, required=True,
+                        help="LSTM model (GRU=0)")
+    parser.add_argument('--model_gru_onnx', type=str, default=None,
+                        help="GRU model (GRU=1)")
+    parser.add_argument('--h_state_len', type=int, default=256)
+    parser.add_argument('--narrowband', action="store_true",
+                        help="8kHz framing with 256-points FFT (NARROWBAND=1)")
+    parser.add_argument('--num_frames', type=int, default=10)
+    args = parser.parse_args()
+
+    if args.narrowband:
+        sample_rate, win_len, win_inc, n_fft = 8000, 200, 50, 256
+    else:
+        sample_rate, win_len, win_inc, n_fft = 16000, 400, 100, 512
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    mags = stft_mags(args.wav_input, sample_rate, win_len, win_inc, n_fft, args.num_frames)
+    write_stft_pack(os.path.join(args.out_dir, 'mags.stft'), mags)
+
+    lstm = run_model(args.model_onnx, mags, args.h_state_len)
+    gru = run_model(args.model_gru_onnx, mags, args.h_state_len) if args.model_gru_onnx else None
+
+    golden_file = os.path.join(args.out_dir, 'golden_sample_0000.h')
+    with open(golden_file, 'w') as fp:
+        fp.write('#define GOLDEN_STFT_MAG {}\n'.format(_array(mags[0])))
+        fp.write('#if IS_INPUT_STFT == 1 \n')
+        fp.write('#ifndef GRU\n')
+        fp.write('#if STFT_FRAMES == 1\n#define GOLDEN_DENOISER {}\n'.format(_array(lstm[0])))
+        fp.write('#elif STFT_FRAMES == 10\n#define GOLDEN_DENOISER {}\n'.format(_array(lstm[min(9, len(lstm)-1)])))
+        fp.write('#else\n#endif\n')
+        fp.write('#else\n')
+        if gru is not None:
+            fp.write('#if STFT_FRAMES == 1\n#define GOLDEN_DENOISER {}\n'.format(_array(gru[0])))
+            fp.write('#elif STFT_FRAMES == 10\n#define GOLDEN_DENOISER {}\n'.format(_array(gru[min(9, len(gru)-1)])))
+            fp.write('#else\n#endif\n')
+        fp.write('#endif\n')
+        fp.write('#endif\n')
+    print('{} STFT frames and goldens written to: {}'.format(len(mags), args.out_dir))
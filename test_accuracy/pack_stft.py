@@ -0,0 +1,80 @@
+# The script writes the packed STFT container read by the NN tests (IS_INPUT_STFT=1):
+# a header followed by the contiguous frames of magnitudes (see stft_pack.h).
+# The frames are computed from a wav file, or taken from the legacy per-frame
+# float32 files (mags_XXXX.bin).
+#
+# Example, 5000 float16 frames for an NN-only benchmark:
+#   python test_accuracy/pack_stft.py --wav_input samples/real_samples/phone_call.wav \
+#       --num_frames 5000 --float16 --output samples/bench.stft
+#   make clean all run platform=gvsoc APP_MODE=3 CHECKSUM=0 STFT_FRAMES=5000 STFT_FILE=$PWD/samples/bench.stft
+
+import argparse
+import struct
+import numpy as np
+
+STFT_PACK_MAGIC = 0x54465453    # "STFT"
+STFT_PACK_VERSION = 1
+STFT_PACK_FLOAT32 = 0
+STFT_PACK_FLOAT16 = 1
+HEADER_FORMAT = '<IHHII'
+# values of the frames for every dtype of the header
+DTYPES = {STFT_PACK_FLOAT32: '<f4', STFT_PACK_FLOAT16: '<f2'}
+
+
+def write_stft_pack(filename, mags, float16=False):
+    mags = np.asarray(mags, dtype=np.float16 if float16 else np.float32)
+    num_frames, num_bins = mags.shape
+    dtype = STFT_PACK_FLOAT16 if float16 else STFT_PACK_FLOAT32
+    with open(filename, 'wb') as fp:
+        fp.write(struct.pack(HEADER_FORMAT, STFT_PACK_MAGIC, STFT_PACK_VERSION, dtype, num_frames, num_bins))
+        fp.write(mags.astype(mags.dtype.newbyteorder('<')).tobytes())
+
+def read_stft_pack(filename):
+    with open(filename, 'rb') as fp:
+        magic, version, dtype, num_frames, num_bins = struct.unpack(
+            HEADER_FORMAT, fp.read(struct.calcsize(HEADER_FORMAT)))
+        if magic != STFT_PACK_MAGIC or version != STFT_PACK_VERSION:
+            raise ValueError('{} is not a packed STFT file'.format(filename))
+        if dtype not in DTYPES:
+            raise ValueError('{}: unknown dtype {}'.format(filename, dtype))
+        data = np.frombuffer(fp.read(), dtype=DTYPES[dtype])
+    return data[:num_frames * num_bins].reshape(num_frames, num_bins)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'STFT packer', description="Write the packed STFT container of the NN tests")
+    parser.add_argument('--output', type=str, required=True,
+                        help="Output .stft file")
+    parser.add_argument('--wav_input', type=str, default=None)
+    parser.add_argument('--mags', type=str, nargs='+', default=None,
+                        help="Legacy float32 frame files, packed in the given order")
+    parser.add_argument('--num_frames', type=int, default=0,
+                        help="Frames taken from the wav file, 0 for all. The wav is looped if shorter")
+    parser.add_argument('--narrowband', action="store_true",
+                        help="8kHz framing with 256-points FFT (NARROWBAND=1)")
+    parser.add_argument('--float16', action="store_true",
+                        help="Store float16 values (half the file size)")
+    args = parser.parse_args()
+
+    if args.mags:
+        mags = np.stack([np.fromfile(f, dtype=np.float32) for f in args.mags])
+    elif args.wav_input:
+        import librosa
+        if args.narrowband:
+            sample_rate, win_len, win_inc, n_fft = 8000, 200, 50, 256
+        else:
+            sample_rate, win_len, win_inc, n_fft = 16000, 400, 100, 512
+        data, _ = librosa.load(args.wav_input, sr=sample_rate)
+        if args.num_frames > 0:
+            samples = (args.num_frames - 1) * win_inc + win_len
+            data = np.resize(data, max(samples, len(data)))
+        mags = np.abs(librosa.stft(data, n_fft=n_fft, hop_length=win_inc, win_length=win_len,
+            window='hann', center=False)).T
+        if args.num_frames > 0:
+            mags = mags[:args.num_frames]
+    else:
+        raise ValueError('either --wav_input or --mags is required')
+
+    write_stft_pack(args.output, mags, args.float16)
+    print('{} frames of {} bins written to: {}'.format(mags.shape[0], mags.shape[1], args.output))
@@ -0,0 +1,255 @@
+import os
+import re
+import sys
+import json
+import pickle
+import argparse
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import test_GAP
+from benchmark_sweep import run_make, parse_cycles, INPUT_FILE
+
+# Automatic mixed precision search of the TinyDenoiser models
+# Every layer of the graph is either kept in float16 or quantized to 8 bits
+# (scaled). The cycles of a layer in both precisions are measured once on
+# gvsoc (AT_GraphPerf of the FP16 and 8 bit builds), so that the cycles of an
+# assignment are estimated without building it. Starting from the all float16
+# model, the layers are moved to 8 bits in order of cycles saved, and a move is
+# kept only if PESQ/STOI on the validation subset (nntool execution) stay above
+# the quality floor. The fastest assignment is written as an nntool script, to
+# be used with QUANT_BITS=FP16MIXED NNTOOL_SCRIPT=<script>.
+
+GRAPH_PERF_NODE = re.compile(r"S\d+_(.+)")
+
+# input/output tensors of the application are float16
+FLOAT_IO = ['input_1', 'output_1']
+
+
+def rnn_nodes(gru):
+    return ['GRU_74', 'GRU_136'] if gru else ['LSTM_78', 'LSTM_144']
+
+def rnn_states(gru):
+    if gru:
+        return ['h_state_GRU_74', 'h_state_GRU_136']
+    return ['i_state_LSTM_78', 'i_state_LSTM_144', 'c_state_LSTM_78', 'c_state_LSTM_144']
+
+def layer_cycles(log):
+    # per layer cycles (AT_GraphPerf averages) keyed by the nntool node name
+    cycles = parse_cycles(log)
+    if cycles is None:
+        return None
+    layers = {}
+    for name, c in cycles.items():
+        m = GRAPH_PERF_NODE.match(name)
+        if m:
+            layers[m.group(1)] = layers.get(m.group(1), 0) + c
+    return layers
+
+def reference_cycles(args):
+    # FP16 and 8 bit builds on gvsoc over the first validation utterance
+    if args.ref_cycles and os.path.isfile(args.ref_cycles):
+        with open(args.ref_cycles) as fp:
+            return json.load(fp)
+
+    import librosa
+    import soundfile as sf
+    data, s = librosa.load(args.noisy_dataset_path + args.filenames[0] + '.wav', sr=args.sample_rate)
+    sf.write(INPUT_FILE, data, args.sample_rate)
+
+    ref = {}
+    for prec, quant in (('float16', 'FP16'), ('int8', '8')):
+        cfg = {'gru': int(args.gru), 'quant': quant, 'h_state_len': args.h_state_len, 'onnx': args.model_onnx}
+        log = run_make("clean all run", cfg)
+        layers = layer_cycles(log) if log else None
+        if not layers:
+            print("Error! no cycles measured for QUANT_BITS=", quant)
+            exit(1)
+        ref[prec] = layers
+
+    if args.ref_cycles:
+        with open(args.ref_cycles, 'w') as fp:
+            json.dump(ref, fp, indent=1)
+    return ref
+
+def estimate_cycles(assign, ref):
+    # layers not in the assignment (e.g. reshapes) are counted as in the FP16 build
+    return sum(ref[assign.get(l, 'float16')].get(l, c) for l, c in ref['float16'].items())
+
+def load_stats(quant_stats_file):
+    with open(quant_stats_file, 'rb') as fp:
+        return pickle.load(fp)
+
+def quantize_model(args, assign, astats):
+    model = test_GAP.nntool_get_model(args.model_onnx, args.gru, True, False, False, False, False, False)
+    node_options = {}
+    for node in rnn_nodes(args.gru) + rnn_states(args.gru):
+        node_options[node] = {"clip_type": "none"}
+    for layer, prec in assign.items():
+        if prec == 'float16':
+            node_options[layer] = {"scheme": "float", "float_type": "float16"}
+    model.quantize(
+        astats,
+        schemes=['scaled', 'float'],
+        graph_options={"use_ne16": False, "clip_type": "std3"},
+        node_options=node_options,
+    )
+    return model
+
+def evaluate(args, assign, astats):
+    model = quantize_model(args, assign, astats)
+    results = [0]
+    # the estimates are never cached: no estimate path
+    test_GAP.model_inference(model, 'fp16mixed', args.filenames, args.noisy_dataset_path,
+                             args.clean_dataset_path, os.devnull + '/', results, 0,
+                             args.sample_rate, args.pad_input, args.gru, args.h_state_len)
+    pesq = float(np.mean([m[0] for m in results[0]]))
+    stoi = float(np.mean([m[1] for m in results[0]]))
+    return pesq, stoi
+
+def write_script(path, assign, gru):
+    lines = ['set debug true', 'adjust', 'fusions --scale8', '']
+    for node in rnn_nodes(gru):
+        lines.append('nodeoption {} RNN_STATES_AS_INPUTS 1'.format(node))
+        if not gru:
+            lines.append('nodeoption {} LSTM_OUTPUT_C_STATE 1'.format(node))
+    lines += ['',
+        'run_pyscript model/nntool_scripts/collect_stats.py samples/quant/ 8 $(GRU) $(MODEL_BUILD)/ $(H_STATE_LEN) $(NUM_BANDS) $(BAND_SCALE) $(FRAME_NFFT) $(SAMPLING_FREQ) $(FRAME_SIZE) $(FRAME_STEP) $(TRAIN_FRAME_SIZE)',
+        'aquant --stats $(MODEL_BUILD)/data_quant.json',
+        '',
+        'qtune --step * clip_type=std3',
+        '']
+    for node in rnn_states(gru) + rnn_nodes(gru):
+        lines.append('qtune --step {} clip_type=none'.format(node))
+    lines += ['', '# layers kept to float16 by test_accuracy/precision_search.py']
+    for layer, prec in assign.items():
+        if prec == 'float16':
+            lines.append('qtune --step {} scheme=float float_type=float16'.format(layer))
+    lines += ['',
+        '# codebook compression of the weights, empty unless COMPRESS_WEIGHTS=1',
+        'run_script $(MODEL_BUILD)/nntool_compress',
+        '',
+        'qshow',
+        '',
+        'set l3_ram_ext_managed true',
+        'set l3_flash_device $(MODEL_L3_FLASH)',
+        'set l3_ram_device $(MODEL_L3_RAM)',
+        '',
+        'set graph_reorder_constant_in true',
+        'set graph_produce_node_names true',
+        'set graph_produce_operinfos true',
+        'set graph_monitor_cycles true',
+        'set graph_const_exec_from_flash $(EXEC_FROM_FLASH)',
+        '',
+        'set graph_async_fork $(GRAPH_ASYNC_FORK)',
+        'set graph_group_weights $(GRAPH_GROUP_WEIGHTS)',
+        '',
+        'save_state',
+        '']
+    with open(path, 'w') as fp:
+        fp.write('\n'.join(lines))
+    print("nntool script stored in: ", path)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        'GAP denoiser precision search', description="Per layer float16/8 bit assignment meeting a quality floor with the lowest cycles")
+
+    parser.add_argument("--model_onnx", type=str, default="model/denoiser.onnx",
+                        help="Onnx model to quantize")
+    parser.add_argument('--gru', action="store_true",
+                        help="Set if the model is GRU-based")
+    parser.add_argument('--h_state_len', type=int, default=256,
+                        help="Size of the RNN states")
+    parser.add_argument("--quant_stats_file", type=str, default="BUILD_MODEL_8BIT/data_quant.json",
+                        help="Quantization stats of the model (model/nntool_scripts/collect_stats.py)")
+
+    parser.add_argument('--pesq_floor', type=float, default=0.0,
+                        help="Minimum PESQ of the validation subset")
+    parser.add_argument('--max_pesq_drop', type=float, default=0.05,
+                        help="Maximum PESQ drop with respect to the float16 model, negative to disable")
+    parser.add_argument('--stoi_floor', type=float, default=0.0,
+                        help="Minimum STOI of the validation subset")
+
+    parser.add_argument("--noisy_dataset_path", type=str, default="samples/dataset/noisy/",
+                        help="Path of the noisy utterances")
+    parser.add_argument("--clean_dataset_path", type=str, default="samples/dataset/clean/",
+                        help="Path of the clean utterances")
+    parser.add_argument('--num_samples', type=int, default=5,
+                        help="Number of utterances of the validation subset, 0 for all of them")
+    parser.add_argument('--sample_rate', default=16000, type=int, help='sample rate')
+    parser.add_argument('--pad_input', type=int, default=300,
+                        help="Pad the input left/right: computed as FRAME_SIZE - FRAME_HOP")
+
+    parser.add_argument("--ref_cycles", type=str, default="",
+                        help="Json file of the per layer reference cycles: measured on gvsoc and stored if missing")
+    parser.add_argument("--output", type=str, default="model/nntool_scripts/nntool_script_search",
+                        help="nntool script of the selected assignment")
+    parser.add_argument('--verify', action="store_true",
+                        help="Build and run the selected script on gvsoc to measure its cycles")
+
+    args = parser.parse_args()
+
+    args.filenames = sorted([os.path.splitext(item)[0] for item in os.listdir(args.noisy_dataset_path)])
+    if args.num_samples > 0:
+        args.filenames = args.filenames[:args.num_samples]
+    if len(args.filenames) == 0:
+        print("Dataset is empty!")
+        exit(1)
+
+    # quantized execution in test_GAP.model_inference
+    test_GAP.real = False
+
+    ref = reference_cycles(args)
+    astats = load_stats(args.quant_stats_file)
+
+    # candidate layers: measured in both builds, sorted by cycles saved in 8 bits
+    saving = {l: ref['float16'][l] - ref['int8'][l] for l in ref['float16'] if l in ref['int8']}
+    layers = [l for l in sorted(saving, key=saving.get, reverse=True) if l not in FLOAT_IO and saving[l] > 0]
+    assign = {l: 'float16' for l in FLOAT_IO + layers}
+
+    pesq, stoi = evaluate(args, assign, astats)
+    pesq_floor = args.pesq_floor
+    if args.max_pesq_drop >= 0:
+        pesq_floor = max(pesq_floor, pesq - args.max_pesq_drop)
+    print("float16: cycles {} PESQ {:.3f} STOI {:.3f}, PESQ floor {:.3f}".format(
+        estimate_cycles(assign, ref), pesq, stoi, pesq_floor))
+    if pesq < pesq_floor or stoi < args.stoi_floor:
+        print("The float16 model does not meet the quality floor!")
+        exit(1)
+
+    history = [('float16', estimate_cycles(assign, ref), pesq, stoi, True)]
+    for layer in layers:
+        assign[layer] = 'int8'
+        p, s = evaluate(args, assign, astats)
+        cycles = estimate_cycles(assign, ref)
+        accepted = p >= pesq_floor and s >= args.stoi_floor
+        print("{} to 8 bits: cycles {} PESQ {:.3f} STOI {:.3f} {}".format(
+            layer, cycles, p, s, 'kept' if accepted else 'rejected'))
+        history.append((layer, cycles, p, s, accepted))
+        if accepted:
+            pesq, stoi = p, s
+        else:
+            assign[layer] = 'float16'
+
+    header = ['8 bit layer', 'cycles/hop (est.)', 'PESQ', 'STOI', 'kept']
+    rows = [[h[0], str(h[1]), '%.3f' % h[2], '%.3f' % h[3], '*' if h[4] else ''] for h in history]
+    widths = [max(len(x) for x in col) for col in zip(header, *rows)]
+    print(' | '.join(h.ljust(w) for h, w in zip(header, widths)))
+    print('-+-'.join('-' * w for w in widths))
+    for row in rows:
+        print(' | '.join(c.ljust(w) for c, w in zip(row, widths)))
+
+    print("Selected: {} layers in 8 bits, cycles {} (float16: {}), PESQ {:.3f} STOI {:.3f}".format(
+        sum(1 for p in assign.values() if p == 'int8'), estimate_cycles(assign, ref), history[0][1], pesq, stoi))
+    write_script(args.output, assign, args.gru)
+
+    if args.verify:
+        cfg = {'gru': int(args.gru), 'quant': 'FP16MIXED', 'h_state_len': args.h_state_len,
+               'onnx': args.model_onnx, 'script': args.output}
+        log = run_make("clean all run", cfg)
+        cycles = parse_cycles(log) if log else None
+        if cycles and 'Total NN' in cycles:
+            print("Measured NN cycles per hop: ", cycles['Total NN'])
+        else:
+            print("Error! the selected script did not run on gvsoc")
@@ -12,12 +12,35 @@ from pystoi import stoi
 
 from threading import Thread
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'model'))
+from gen_band_lut import band_tables, band_pool, band_expand
+from wiener_ref import WienerEngine
+
+# STFT framing, must match the FRAME_SIZE / FRAME_STEP / FRAME_NFFT settings of the Makefile
+TRAIN_WIN_LEN = 400
+WIN_LEN = 400
+WIN_INC = 100
+FFT_LEN = 512
+LOW_LATENCY = False
+MIXED_RADIX = False
+NARROWBAND = False
+# band compression frontend, must match the NUM_BANDS / BAND_SCALE settings of the Makefile
+NUM_BANDS = 0
+BAND_SCALE = 'erb'
+# nn | wiener (classical spectral suppression, WIENER=1)
+ENGINE = 'nn'
+
 def run_on_gap_gvsoc(input_file, output_file, compile=True, gru=False, 
                 quant_opt='fp16' ):
     runner_args  =  " SILENT=1 APP_MODE=1 CHECKSUM=0" 
     runner_args +=  " GRU=1" if gru else "" 
+    runner_args +=  " LOW_LATENCY=1" if LOW_LATENCY else "" 
+    runner_args +=  " NARROWBAND=1" if NARROWBAND else "" 
+    runner_args +=  " FFT_MIXED_RADIX=1" if MIXED_RADIX else "" 
+    runner_args +=  " NUM_BANDS="+str(NUM_BANDS)+" BAND_SCALE="+BAND_SCALE if NUM_BANDS > 0 else "" 
+    runner_args +=  " WIENER=1" if ENGINE == 'wiener' else "" 
     runner_args +=  " WAV_FILE="+input_file
-    runner_args +=  " QUANT_BITS=FP16" if quant_opt=='fp16' else  " QUANT_BITS=8" if quant_opt=='int8' else " QUANT_BITS=FP16MIXED" if quant_opt=='fp16mixed' else ""
+    runner_args +=  " QUANT_BITS=FP16" if quant_opt=='fp16' else  " QUANT_BITS=8" if quant_opt=='int8' else " QUANT_BITS=FP16MIXED" if quant_opt=='fp16mixed' else " QUANT_BITS=NE16" if quant_opt=='ne16' else " QUANT_BITS=BFP16" if quant_opt=='bfp16' else ""
 
     if compile:
         run_command = "make clean all run platform=gvsoc"+ runner_args
@@ -50,7 +73,7 @@ def denoise_sample_on_gap_gvsoc(input_file, output_file, samplerate, padding = F
 
 def nntool_get_model(model_onnx, gru, real, quant_fp16,  quant_bfp16, quant_int8, 
                     quant_ne16, ne_16_type, quant_stats_file=None, clip_type=None, 
-                    max_rnn=False, linear_fp16=False):
+                    max_rnn=False, linear_fp16=False, compress_bits=0):
     # nntool
     sys.path.insert(0, os.environ['NNTOOL_DIR'])
     from nntool.api import NNGraph
@@ -211,6 +234,15 @@ def nntool_get_model(model_onnx, gru, real, quant_fp16,  quant_bfp16, quant_int8
         }
         node_options = {}
 
+    elif quant_bfp16: # bfloat16
+        
+        scheme = ['float']
+        graph_options = {
+            "scheme": 'float',
+            "float_type" : 'bfloat16'
+        }
+        node_options = {}
+
         
     print(model.show())
     if not real:
@@ -222,6 +254,11 @@ def nntool_get_model(model_onnx, gru, real, quant_fp16,  quant_bfp16, quant_int8
         )
         
         print(model.qshow())
+
+        if compress_bits > 0:
+            # codebook compression of the weights, as COMPRESS_WEIGHTS=1 on GAP
+            from nntool.interpreter.nntool_shell import NNToolShell
+            NNToolShell.run_commands_on_graph(model, ['compress * --bits {}'.format(compress_bits)])
     
 
     return model
@@ -230,7 +267,8 @@ def nntool_get_model(model_onnx, gru, real, quant_fp16,  quant_bfp16, quant_int8
 def model_inference(nntool_model, quant_opt, filenames, noisy_path, clean_path, 
         estimate_path, results, thread_id, 
         samplerate, padding, gru, h_state_len, dry=0.0):
-    from nntool.api.utils import qsnrs
+    if ENGINE == 'nn':
+        from nntool.api.utils import qsnrs
 
     compile_GAP = False     # switch to True to compile GAP at the first time
 
@@ -262,9 +300,9 @@ def model_inference(nntool_model, quant_opt, filenames, noisy_path, clean_path,
                     data = np.pad(data, (padding, padding))
                     print(data)
 
-                win_len = 400
-                win_inc = 100 
-                fft_len = 512
+                win_len = WIN_LEN
+                win_inc = WIN_INC 
+                fft_len = FFT_LEN
                 print('data input shape:', data.shape)
 
                 stft_frame_i = librosa.stft(
@@ -278,6 +316,12 @@ def model_inference(nntool_model, quant_opt, filenames, noisy_path, clean_path,
                 stft_frame_i_T = np.transpose (stft_frame_i) # swap the axis to select the tmestamp
                 stft_frame_o_T = np.empty_like(stft_frame_i_T)
 
+                if NUM_BANDS > 0:
+                    band_idx, band_weight, band_norm = band_tables(fft_feat, NUM_BANDS, samplerate, BAND_SCALE)
+
+                if ENGINE == 'wiener':
+                    wiener = WienerEngine(NUM_BANDS if NUM_BANDS > 0 else fft_feat, samplerate, win_inc)
+
                 rnn_0_i_state = np.zeros(h_state_len)
                 rnn_1_i_state = np.zeros(h_state_len)
 
@@ -289,9 +333,18 @@ def model_inference(nntool_model, quant_opt, filenames, noisy_path, clean_path,
                 for i in range (num_win):
         #                    print('*****Frame ' + str(i) + ' ******')
                     stft_clip = stft_frame_i_T[i]
-                    stft_clip_mag = np.abs(stft_clip)
+                    stft_clip_mag = np.abs(stft_clip) * TRAIN_WIN_LEN / win_len
+                    if NUM_BANDS > 0:
+                        stft_clip_mag = band_pool(stft_clip_mag, band_idx, band_weight, band_norm)
         #                    print(stft_clip_mag)
 
+                    if ENGINE == 'wiener':
+                        stft_clip_mag_estimate = wiener.process(stft_clip_mag)
+                        if NUM_BANDS > 0:
+                            stft_clip_mag_estimate = band_expand(stft_clip_mag_estimate, band_idx, band_weight)
+                        stft_frame_o_T[i] = stft_clip * stft_clip_mag_estimate
+                        continue
+
                     if gru == 1:
                         data = [stft_clip_mag, rnn_0_i_state, rnn_1_i_state]
                     else:
@@ -337,6 +390,8 @@ def model_inference(nntool_model, quant_opt, filenames, noisy_path, clean_path,
 
 
                     stft_clip_mag_estimate = mag_out.squeeze()
+                    if NUM_BANDS > 0:
+                        stft_clip_mag_estimate = band_expand(stft_clip_mag_estimate, band_idx, band_weight)
 
                     stft_clip = stft_clip * stft_clip_mag_estimate
                     stft_frame_o_T[i] = stft_clip
@@ -511,7 +566,7 @@ def get_stoi(ref_sig, out_sig, sr):
     return stoi_val
 
 def _run_metrics(clean, estimate, samplerate):
-    pesq_i = pesq(samplerate, clean, estimate, 'wb')
+    pesq_i = pesq(samplerate, clean, estimate, 'wb' if samplerate == 16000 else 'nb')
     stoi_i = stoi(clean, estimate, samplerate, extended=False)
     return pesq_i, stoi_i
 
@@ -571,8 +626,40 @@ if __name__ == "__main__":
                         help="Empty | LUT")
     parser.add_argument('--dry', type=float, default=0.0,
                         help="Setting the dry parameter")  
+    parser.add_argument('--low_latency', action="store_true",
+                        help="Use the low latency framing (LOW_LATENCY=1)")  
+    parser.add_argument('--narrowband', action="store_true",
+                        help="8kHz framing with 256-points FFT and 129 bins (NARROWBAND=1), sets --sample_rate 8000")  
+    parser.add_argument('--mixed_radix', action="store_true",
+                        help="Native FFT size equal to the frame size, e.g. 201 bins (FFT_MIXED_RADIX=1)")  
+    parser.add_argument('--num_bands', type=int, default=0,
+                        help="Pool the STFT bins into bands before the NN (NUM_BANDS), 0 to feed all the bins")  
+    parser.add_argument('--band_scale', type=str, default='erb',
+                        help="erb | mel")  
+    parser.add_argument('--compress_bits', type=int, default=0,
+                        help="Bits of the weight codebook indices (COMPRESS_WEIGHTS=1), 0 if not compressed")
+    parser.add_argument('--engine', type=str, default='nn',
+                        help="nn | wiener: classical spectral suppression instead of the NN (WIENER=1)")
     
     args = parser.parse_args()
+
+    if args.low_latency:
+        LOW_LATENCY = True
+        WIN_LEN = 96
+        WIN_INC = 32
+    if args.narrowband:
+        NARROWBAND = True
+        args.sample_rate = 8000
+        TRAIN_WIN_LEN = 200
+        WIN_LEN = 200
+        WIN_INC = 50
+        FFT_LEN = 256
+    if args.mixed_radix:
+        MIXED_RADIX = True
+        FFT_LEN = WIN_LEN
+    NUM_BANDS = args.num_bands
+    BAND_SCALE = args.band_scale
+    ENGINE = args.engine
     
 
     # parse the quantization method
@@ -602,10 +689,13 @@ if __name__ == "__main__":
         args.max_rnn = True
     
     # prepare nntool executer if needed
-    if args.nntool:
+    if args.nntool and ENGINE == 'wiener':
+        nntool_model = 'wiener'     # python twin of wiener.c, no graph to load
+    elif args.nntool:
         print('Going to setup the nntool executer form model {}'.format(args.model_onnx) )
         nntool_model = nntool_get_model(args.model_onnx, args.gru, real, fp16, bfp16, int8, ne16, ne_16_type, args.quant_stats_file,
-                                       clip_type=args.clip_type, max_rnn=args.max_rnn, linear_fp16=args.linear_fp16)
+                                       clip_type=args.clip_type, max_rnn=args.max_rnn, linear_fp16=args.linear_fp16,
+                                       compress_bits=args.compress_bits)
     else:
         nntool_model = False
     
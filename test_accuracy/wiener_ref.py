@@ -0,0 +1,52 @@
+# Python twin of the classical spectral suppression engine (wiener.c, WIENER=1):
+# minimum statistics noise tracking and decision-directed Wiener gain, frame by
+# frame on the STFT magnitudes, with the same constants of the GAP code.
+# Used by test_GAP.py --engine wiener to compare PESQ/STOI against the NN.
+
+import numpy as np
+
+ALPHA_S = 0.85      # smoothing of the power spectrum
+ALPHA_DD = 0.98     # weight of the previous frame in the a priori SNR
+BIAS = 1.5          # compensation of the minimum of the smoothed power
+GAIN_MIN = 0.1      # max attenuation (-20 dB)
+SUBWINS = 8         # sub-windows of the minimum search (about 1.5 s overall)
+EPS = 1e-10
+
+
+class WienerEngine:
+    def __init__(self, num_bins, samplerate=16000, hop=100):
+        self.num_bins = num_bins
+        self.subwin_hops = (3 * samplerate) // (2 * hop * SUBWINS)
+        self.reset = True
+
+    def process(self, mag):
+        # returns the gains of a frame of magnitudes (same format of the NN mask)
+        y2 = np.asarray(mag, dtype=np.float32) ** 2 + EPS
+        if self.reset:
+            self.smooth_power = y2.copy()
+            self.speech_power = y2.copy()
+            self.win_min = np.tile(y2, (SUBWINS, 1))
+            self.sub_hop = 0
+            self.win_idx = 0
+            self.reset = False
+
+        self.smooth_power = ALPHA_S * self.smooth_power + (1 - ALPHA_S) * y2
+        if self.sub_hop == 0:
+            self.sub_min = self.smooth_power.copy()
+        else:
+            self.sub_min = np.minimum(self.sub_min, self.smooth_power)
+        p_min = np.minimum(self.sub_min, self.win_min.min(axis=0))
+        if self.sub_hop == self.subwin_hops - 1:
+            self.win_min[self.win_idx] = self.sub_min
+        noise = BIAS * p_min
+
+        ml_snr = np.maximum(y2 / noise - 1.0, 0.0)
+        xi = ALPHA_DD * self.speech_power / noise + (1 - ALPHA_DD) * ml_snr
+        gain = np.maximum(xi / (1.0 + xi), GAIN_MIN)
+        self.speech_power = gain * gain * y2
+
+        self.sub_hop += 1
+        if self.sub_hop == self.subwin_hops:
+            self.sub_hop = 0
+            self.win_idx = (self.win_idx + 1) % SUBWINS
+        return gain
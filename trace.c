@@ -0,0 +1,115 @@
+#include "trace.h"
+
+#include <bsp/fs/hostfs.h>
+
+
+PI_L2 trace_record_t trace_ring[TRACE_RECORDS];
+uint32_t trace_head;
+uint16_t trace_frame;
+uint8_t trace_flags;
+
+static PI_L2 trace_header_t trace_header;
+static struct pi_device trace_fs;
+static pi_fs_file_t *trace_file;
+static pi_task_t trace_task;
+static volatile int trace_busy;
+static uint32_t trace_clipped;      // saturated samples at the start of the hop
+
+
+static void trace_write_done(void *arg)
+{
+    trace_busy = 0;
+}
+
+// record without the check of the end of the half, used while flushing
+static void trace_put(uint8_t event, uint8_t flags, uint32_t stamp)
+{
+    trace_record_t *r = &trace_ring[trace_head];
+    r->stamp = stamp;
+    r->frame = trace_frame;
+    r->event = event;
+    r->flags = flags;
+    trace_head = (trace_head + 1) & (TRACE_RECORDS - 1);
+}
+
+int trace_open(const char *path, uint32_t hop_us)
+{
+    trace_head = 0;
+    trace_frame = 0;
+    trace_busy = 0;
+    trace_file = NULL;
+    gap_fc_starttimer();
+    gap_fc_resethwtimer();
+
+    if (path == NULL) return 0;
+
+    struct pi_hostfs_conf conf;
+    pi_hostfs_conf_init(&conf);
+    pi_open_from_conf(&trace_fs, &conf);
+    if (pi_fs_mount(&trace_fs))
+        return -1;
+
+    trace_file = pi_fs_open(&trace_fs, path, PI_FS_FLAGS_WRITE);
+    if (trace_file == NULL) {
+        pi_fs_unmount(&trace_fs);
+        return -2;
+    }
+
+    trace_header.magic = TRACE_MAGIC;
+    trace_header.version = TRACE_VERSION;
+    trace_header.record_size = sizeof(trace_record_t);
+    trace_header.clock_hz = pi_freq_get(PI_FREQ_DOMAIN_FC);
+    trace_header.hop_us = hop_us;
+    pi_fs_write(trace_file, &trace_header, sizeof(trace_header_t));
+    return 0;
+}
+
+void trace_flush_half(uint32_t half)
+{
+    if (trace_file == NULL) return;
+
+    // the half to be filled next is still being written: the hop waits for it,
+    // the stall is recorded once the half is free
+    if (trace_busy) {
+        uint32_t stamp = gap_fc_readhwtimer();
+        while (trace_busy) pi_yield();
+        trace_put(TRACE_FLUSH, TRACE_FLAG_OVERRUN, stamp);
+        trace_put(TRACE_FLUSH | TRACE_STOP_BIT, TRACE_FLAG_OVERRUN, gap_fc_readhwtimer());
+    }
+
+    trace_busy = 1;
+    pi_fs_write_async(trace_file, &trace_ring[half * TRACE_RECORDS/2],
+        TRACE_RECORDS/2 * sizeof(trace_record_t), pi_task_callback(&trace_task, trace_write_done, NULL));
+}
+
+void trace_close(void)
+{
+    if (trace_file == NULL) return;
+
+    while (trace_busy) pi_yield();
+
+    // records of the half being filled
+    uint32_t start = trace_head & ~(TRACE_RECORDS/2 - 1);
+    if (trace_head > start) {
+        pi_fs_write(trace_file, &trace_ring[start], (trace_head - start) * sizeof(trace_record_t));
+    }
+    pi_fs_close(trace_file);
+    pi_fs_unmount(&trace_fs);
+    trace_file = NULL;
+}
+
+void trace_hop_start(uint16_t frame, uint32_t clipped)
+{
+    trace_frame = frame;
+    trace_clipped = clipped;
+    trace_flags = 0;
+    trace_event(TRACE_HOP, 0);
+}
+
+void trace_hop_stop(uint32_t proc_us, uint32_t deadline_us, uint32_t clipped)
+{
+    uint8_t flags = trace_flags;
+    if (deadline_us > 0 && proc_us > deadline_us) flags |= TRACE_FLAG_DEADLINE;
+    if (clipped != trace_clipped) flags |= TRACE_FLAG_CLIPPING;
+    trace_event(TRACE_HOP | TRACE_STOP_BIT, flags);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <stdint.h>
+#include "pmsis.h"
+#include "Gap.h"
+
+
+/*
+ * Binary event trace
+ *
+ * Fixed-size records (FC timer stamp, frame id, event, flags) are written in
+ * an L2 ring of TRACE_RECORDS entries. Every time a half of the ring is full
+ * it is written to the trace file with an asynchronous request, while the
+ * other half is filled. Without a file (e.g. on board) the ring wraps and
+ * keeps the last TRACE_RECORDS events. The file is decoded by
+ * test_accuracy/decode_trace.py.
+ */
+#define TRACE_MAGIC         (0x45435254)    // "TRCE"
+#define TRACE_VERSION       (1)
+
+// power of two
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS       (512)
+#endif
+
+// stages, the stop event has TRACE_STOP_BIT set
+#define TRACE_HOP           (0)
+#define TRACE_INPUT         (1)
+#define TRACE_STFT          (2)
+#define TRACE_NN            (3)
+#define TRACE_ISTFT         (4)
+#define TRACE_OUTPUT        (5)
+#define TRACE_FLUSH         (6)     // wait for the previous write of the ring
+#define TRACE_STOP_BIT      (0x80)
+
+// anomaly flags of the stop events
+#define TRACE_FLAG_DEADLINE (1<<0)  // the hop took longer than the hop period
+#define TRACE_FLAG_CLIPPING (1<<1)  // output samples saturated during the hop
+#define TRACE_FLAG_OVERRUN  (1<<2)  // the ring was full and the trace stalled the hop
+#define TRACE_FLAG_LOST     (1<<3)  // input chunks overwritten or missing before the hop
+#define TRACE_FLAG_DEGRADED (1<<4)  // late hop, processed by the overrun policy
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t clock_hz;      // frequency of the stamps
+    uint32_t hop_us;        // deadline of a hop, 0 if not real-time
+} trace_header_t;
+
+typedef struct {
+    uint32_t stamp;         // FC timer
+    uint16_t frame;
+    uint8_t event;
+    uint8_t flags;
+} trace_record_t;
+
+extern PI_L2 trace_record_t trace_ring[TRACE_RECORDS];
+extern uint32_t trace_head;
+extern uint16_t trace_frame;
+extern uint8_t trace_flags;
+
+/*
+ * \brief start the timer and open the trace file (NULL to keep the trace in L2 only)
+ */
+int trace_open(const char *path, uint32_t hop_us);
+
+/*
+ * \brief write a half of the ring to the file, called by trace_event
+ */
+void trace_flush_half(uint32_t half);
+
+/*
+ * \brief write the pending records and close the trace file
+ */
+void trace_close(void);
+
+/*
+ * \brief append a record, a few cycles when the ring does not need to be flushed
+ */
+static inline void trace_event(uint8_t event, uint8_t flags)
+{
+    trace_record_t *r = &trace_ring[trace_head];
+    r->stamp = gap_fc_readhwtimer();
+    r->frame = trace_frame;
+    r->event = event;
+    r->flags = flags;
+    trace_head = (trace_head + 1) & (TRACE_RECORDS - 1);
+    if ((trace_head & (TRACE_RECORDS/2 - 1)) == 0) {
+        trace_flush_half((trace_head == 0) ? 1 : 0);
+    }
+}
+
+/*
+ * \brief start of a hop, clipped is the count of saturated samples so far
+ */
+void trace_hop_start(uint16_t frame, uint32_t clipped);
+
+/*
+ * \brief flag the current hop, reported by trace_hop_stop
+ */
+static inline void trace_hop_flag(uint8_t flag)
+{
+    trace_flags |= flag;
+}
+
+/*
+ * \brief end of a hop, flagged if late (deadline_us not 0) or if new samples were clipped
+ */
+void trace_hop_stop(uint32_t proc_us, uint32_t deadline_us, uint32_t clipped);
+
+#ifdef TRACE
+#define TRACE_HOP_START(frame, clipped)     trace_hop_start((frame), (clipped))
+#define TRACE_HOP_STOP(us, deadline, clipped) trace_hop_stop((us), (deadline), (clipped))
+#define TRACE_HOP_FLAG(flag)                trace_hop_flag(flag)
+#define TRACE_START(stage)                  trace_event((stage), 0)
+#define TRACE_STOP(stage)                   trace_event((stage) | TRACE_STOP_BIT, 0)
+#else
+#define TRACE_HOP_START(frame, clipped)
+#define TRACE_HOP_STOP(us, deadline, clipped)
+#define TRACE_HOP_FLAG(flag)
+#define TRACE_START(stage)
+#define TRACE_STOP(stage)
+#endif
@@ -0,0 +1,129 @@
+#include "wiener.h"
+#ifdef MODEL_SET
+#include "model_set.h"
+#endif
+
+
+// smoothing of the power spectrum
+#ifndef WIENER_ALPHA_S
+#define WIENER_ALPHA_S      (0.85f)
+#endif
+// weight of the previous frame in the decision-directed a priori SNR
+#ifndef WIENER_ALPHA_DD
+#define WIENER_ALPHA_DD     (0.98f)
+#endif
+// compensation of the minimum of the smoothed power, below the mean noise power
+#ifndef WIENER_BIAS
+#define WIENER_BIAS         (1.5f)
+#endif
+// max attenuation (-20 dB), limits the musical noise
+#ifndef WIENER_GAIN_MIN
+#define WIENER_GAIN_MIN     (0.1f)
+#endif
+#define WIENER_EPS          (1e-10f)
+
+// the powers are kept in float32: the squared magnitudes exceed the float16 range on loud inputs
+static PI_L2 float Smooth_Power[WIENER_BINS];
+static PI_L2 float Sub_Min[WIENER_BINS];                    // minimum of the current sub-window
+static PI_L2 float Win_Min[WIENER_SUBWINS][WIENER_BINS];    // minima of the last sub-windows
+static PI_L2 float Speech_Power[WIENER_BINS];               // estimate of the previous frame
+static int Sub_Hop;
+static int Win_Idx;
+
+typedef struct {
+    WIENER_TYPE *mag;
+    int reset;
+} wiener_arg_t;
+
+
+// range of the n items processed by the current core
+static inline void core_chunk(int n, int *first, int *last)
+{
+    int chunk = (n + pi_cl_team_nb_cores() - 1) / pi_cl_team_nb_cores();
+    *first = pi_core_id() * chunk;
+    *last = (*first + chunk < n) ? (*first + chunk) : n;
+}
+
+static void wiener_core(void *arg)
+{
+    wiener_arg_t *a = (wiener_arg_t *) arg;
+    int first, last;
+    core_chunk(WIENER_BINS, &first, &last);
+
+    for (int k = first; k < last; k++) {
+        float y2 = (float) a->mag[k];
+        y2 = y2 * y2 + WIENER_EPS;
+
+        if (a->reset) {
+            Smooth_Power[k] = y2;
+            Speech_Power[k] = y2;
+            for (int u = 0; u < WIENER_SUBWINS; u++) Win_Min[u][k] = y2;
+        }
+
+        // minimum statistics: the minimum of the smoothed power tracks the noise floor
+        float p = WIENER_ALPHA_S * Smooth_Power[k] + (1.0f - WIENER_ALPHA_S) * y2;
+        Smooth_Power[k] = p;
+        float sub_min = (Sub_Hop == 0 || p < Sub_Min[k]) ? p : Sub_Min[k];
+        Sub_Min[k] = sub_min;
+        float p_min = sub_min;
+        for (int u = 0; u < WIENER_SUBWINS; u++) {
+            if (Win_Min[u][k] < p_min) p_min = Win_Min[u][k];
+        }
+        if (Sub_Hop == WIENER_SUBWIN_HOPS - 1) Win_Min[Win_Idx][k] = sub_min;
+        float noise = WIENER_BIAS * p_min;
+
+        // decision-directed a priori SNR and Wiener gain
+        float ml_snr = y2 / noise - 1.0f;
+        if (ml_snr < 0.0f) ml_snr = 0.0f;
+        float xi = WIENER_ALPHA_DD * Speech_Power[k] / noise + (1.0f - WIENER_ALPHA_DD) * ml_snr;
+        float gain = xi / (1.0f + xi);
+        if (gain < WIENER_GAIN_MIN) gain = WIENER_GAIN_MIN;
+
+        Speech_Power[k] = gain * gain * y2;
+        a->mag[k] = (WIENER_TYPE) gain;
+    }
+}
+
+void wiener_run(WIENER_TYPE *mag, int reset)
+{
+    if (reset) {
+        Sub_Hop = 0;
+        Win_Idx = 0;
+    }
+    wiener_arg_t arg = { mag, reset };
+    pi_cl_team_fork(pi_cl_cluster_nb_cores(), wiener_core, &arg);
+
+    if (++Sub_Hop == WIENER_SUBWIN_HOPS) {
+        Sub_Hop = 0;
+        Win_Idx = (Win_Idx + 1) % WIENER_SUBWINS;
+    }
+}
+
+
+#ifdef MODEL_SET
+/*
+    Entry of the model set (MODEL_SET=... wiener): the cheapest one, taken when no NN fits the budget
+*/
+static int wiener_construct(void)
+{
+    return 0;
+}
+
+static void wiener_entry_run(void *io, int reset)
+{
+    wiener_run((WIENER_TYPE *) io, reset);
+}
+
+model_entry_t wiener_Entry = {
+    .name = "wiener",
+    .construct = wiener_construct,
+    .destruct = wiener_construct,
+    .run = wiener_entry_run,
+    .l1_memory = NULL,
+    .l1_size = 0,
+    .l2_memory = NULL,
+    .l2_dyn_size = 0,
+    .l2_size = (3 + WIENER_SUBWINS) * WIENER_BINS * sizeof(float),
+    .state_len = 0,
+};
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include "pmsis.h"
+
+
+// same datatype of the NN input/output
+#ifdef DSP_BFLOAT16
+#define WIENER_TYPE float16alt
+#else
+#define WIENER_TYPE float16
+#endif
+
+// bins (or bands) of the NN buffer
+#define WIENER_BINS         (AT_INPUT_WIDTH*AT_INPUT_HEIGHT)
+
+// the minimum of the smoothed power is searched over WIENER_SUBWINS sub-windows of about 1.5 s overall
+#ifndef WIENER_SUBWINS
+#define WIENER_SUBWINS      (8)
+#endif
+#define WIENER_SUBWIN_HOPS  ((3 * SAMPLING_FREQ) / (2 * FRAME_STEP * WIENER_SUBWINS))
+
+/*
+ * \brief classical spectral suppression, to be called from the cluster master core
+ *
+ * Low power alternative to the NN with the same interface: the magnitudes in
+ * mag are replaced by the gains in [WIENER_GAIN_MIN, 1], so the mask is
+ * applied to the spectrogram as the NN one. The noise power is tracked by
+ * minimum statistics (minimum of the smoothed power over the last 1.5 s,
+ * compensated by a fixed bias) and the gain is the Wiener one of the
+ * decision-directed a priori SNR. The bins are split among the cluster cores.
+ * reset restarts the noise tracking from the current frame.
+ */
+void wiener_run(WIENER_TYPE *mag, int reset);